@@ -0,0 +1,523 @@
+/*
+* FILE          : Benchmark.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the benchmarks run with the -b flag. They build libraries from the URLs of a file
+*                 and time the main operations on them, so changes to the data structures can be measured
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+#include "Citations.h"
+
+// Define constants
+#define BENCHMARK_MIN_SIZE	1000	// Smallest library measured by the scaling benchmark (each size is 10 times larger)
+#define BENCHMARK_MIN_THREADS	4	// Threads the thread benchmark goes up to even with fewer processors
+#define BENCHMARK_SORT_MAX	50000	// Largest queue sorted by insertion in the sort benchmark (the time grows as n^2)
+#define BENCHMARK_ADD_COUNT	1000	// Citations added to each library by the ordered index benchmark
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+// Heap allocations counted while the allocation benchmark runs (debug builds only)
+static std::atomic<long long> gHeapAllocations(0);
+
+//
+// FUNCTION     : CountHeapAllocation
+// DESCRIPTION  : Debug heap hook that counts every malloc, calloc and realloc (run by the C runtime)
+// PARAMETERS   : int allocType : _HOOK_ALLOC, _HOOK_REALLOC or _HOOK_FREE
+//                the rest      : Details of the block, not used
+// RETURNS      : int           : TRUE so the allocation goes ahead
+//
+static int CountHeapAllocation(int allocType, void* userData, size_t size, int blockType, long requestNumber,
+	const unsigned char* filename, int lineNumber) {
+	if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) {
+		gHeapAllocations++;
+	}
+	return TRUE;
+}
+#endif
+
+//
+// FUNCTION     : SecondsSince
+// DESCRIPTION  : Returns the time passed since a point in time
+// PARAMETERS   : std::chrono::steady_clock::time_point start : Point in time
+// RETURNS      : double                                      : Seconds
+//
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//
+// FUNCTION     : AddURLs
+// DESCRIPTION  : Adds URLs of a list to a library on this thread, the same way a file is imported
+// PARAMETERS   : CitationManager* Citations : Hash table to add the citations to
+//                Queue* CitationsToProcess  : Queue to add the citations to
+//                URLList* list              : URLs to add from
+//                int first                  : First URL of the list to add
+//                int count                  : Number of URLs to add
+// RETURNS      : double                     : Seconds taken
+//
+static double AddURLs(CitationManager* Citations, Queue* CitationsToProcess, URLList* list, int first, int count) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = first; i < first + count; i++) {
+		const char* key = list->Text + list->Keys[i];
+		InsertCanonicalData(Citations, CitationsToProcess, list->Text + list->URLs[i], HashKey(Citations, key));
+	}
+	return SecondsSince(start);
+}
+
+//
+// FUNCTION     : ClearLibrary
+// DESCRIPTION  : Deletes every citation in a queue from the library and frees it, the same way citations are removed
+//                from the menu
+// PARAMETERS   : CitationManager* Citations : Hash table containing the citations
+//                Queue* CitationsToProcess  : Queue of the citations to delete
+// RETURNS      : double                     : Seconds taken
+//
+static double ClearLibrary(CitationManager* Citations, Queue* CitationsToProcess) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (!isQueueEmpty(CitationsToProcess)) {
+		Citation* citation = Dequeue(CitationsToProcess);
+		DeleteHashTable(Citations, SearchKVPHashTable(Citations, GetCitationURL(citation)));
+		FreeCitation(citation);
+	}
+	return SecondsSince(start);
+}
+
+//
+// FUNCTION     : FreeLibrary
+// DESCRIPTION  : Deletes every citation of a library built by a benchmark, then frees its hash table and queue
+// PARAMETERS   : CitationManager* Citations : Hash table to free
+//                Queue* CitationsToProcess  : Queue to free (holding every citation of the hash table)
+// RETURNS      : void
+//
+static void FreeLibrary(CitationManager* Citations, Queue* CitationsToProcess) {
+	ClearLibrary(Citations, CitationsToProcess);
+	FreeHashTable(Citations);
+	FreeQueue(CitationsToProcess);
+	free(CitationsToProcess);
+}
+
+//
+// FUNCTION     : BenchmarkScaling
+// DESCRIPTION  : Times adding, finding and deleting every citation of libraries from BENCHMARK_MIN_SIZE URLs up to
+//                every URL of the list, growing 10 times each step. The hash table grows as the citations are added,
+//                so the time per operation should stay about the same at every size
+// PARAMETERS   : URLList* list : URLs to build the libraries from
+// RETURNS      : void
+//
+static void BenchmarkScaling(URLList* list) {
+	printf("\nHash table scaling (one thread, time per citation):\n");
+	printf("------------------------------------------------------------------------------\n");
+	printf("%10s %14s %14s %14s\n", "URLs", "Add", "Search", "Delete");
+
+	int size = list->Count < BENCHMARK_MIN_SIZE ? list->Count : BENCHMARK_MIN_SIZE;
+	while (true) {
+		CitationManager* Citations = InitializeHashTable();
+		Queue* CitationsToProcess = InitializeQueue();
+		double addSeconds = AddURLs(Citations, CitationsToProcess, list, 0, size);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		int found = 0;
+		for (int i = 0; i < size; i++) {
+			const char* key = list->Text + list->Keys[i];
+			if (SearchKeyHashTable(Citations, key, HashKey(Citations, key)) != NULL) {
+				found++;
+			}
+		}
+		double searchSeconds = SecondsSince(start);
+		double deleteSeconds = ClearLibrary(Citations, CitationsToProcess);
+
+		printf("%10d %11.0f ns %11.0f ns %11.0f ns%s\n", size, addSeconds * 1e9 / size, searchSeconds * 1e9 / size,
+			deleteSeconds * 1e9 / size, found == size ? "" : "  (citations missing)");
+		FreeLibrary(Citations, CitationsToProcess);
+
+		if (size == list->Count) {
+			break;
+		}
+		size = size > list->Count / 10 ? list->Count : size * 10;
+	}
+}
+
+//
+// FUNCTION     : AddWorker
+// DESCRIPTION  : Adds every step-th URL of a list to a shared hash table (run by each thread of BenchmarkThreads)
+// PARAMETERS   : CitationManager* Citations : Hash table to add the citations to
+//                URLList* list              : URLs to add from
+//                int first                  : First URL to add
+//                int step                   : Number of threads adding URLs
+//                int* added                 : Set to the number of citations this thread added
+// RETURNS      : void
+//
+static void AddWorker(CitationManager* Citations, URLList* list, int first, int step, int* added) {
+	int count = 0;
+	for (int i = first; i < list->Count; i += step) {
+		Citation* citation = InitializeCitation(list->Text + list->URLs[i]);
+		if (InsertHashTableWithHash(Citations, citation, HashKey(Citations, list->Text + list->Keys[i]))) {
+			count++;
+		}
+		else {
+			FreeCitation(citation);
+		}
+	}
+	*added = count;
+}
+
+//
+// FUNCTION     : SearchWorker
+// DESCRIPTION  : Searches a shared hash table for every URL of a list, starting part way through the list so threads
+//                do not search the same shard at the same time (run by each thread of BenchmarkThreads). A URL only
+//                counts as found if the citation's URL, read from the citation store, is the one searched for
+// PARAMETERS   : CitationManager* Citations : Hash table to search
+//                URLList* list              : URLs to search for
+//                int first                  : URL to start from
+//                int* found                 : Set to the number of URLs found
+// RETURNS      : void
+//
+static void SearchWorker(CitationManager* Citations, URLList* list, int first, int* found) {
+	int count = 0;
+	for (int n = 0; n < list->Count; n++) {
+		int i = (first + n) % list->Count;
+		const char* key = list->Text + list->Keys[i];
+		CitationKVP* kvp = SearchKeyHashTable(Citations, key, HashKey(Citations, key));
+		if (kvp != NULL && strcmp(GetCitationURL(kvp->Citation), list->Text + list->URLs[i]) == 0) {
+			count++;
+		}
+	}
+	*found = count;
+}
+
+//
+// FUNCTION     : BenchmarkThreads
+// DESCRIPTION  : Times adding every URL of the list to one shared hash table, and then searching for every URL on
+//                every thread, with 1, 2, 4, ... threads up to one per processor (at least BENCHMARK_MIN_THREADS).
+//                This is also the check that citations can be created and inserted from several threads at once:
+//                every citation must be added exactly once, be in the ordered index, and be found with its own URL
+//                by every thread, or the run is reported as failed
+// PARAMETERS   : URLList* list : URLs to add
+// RETURNS      : void
+//
+static void BenchmarkThreads(URLList* list) {
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	if (maxThreads < BENCHMARK_MIN_THREADS) {
+		maxThreads = BENCHMARK_MIN_THREADS;
+	}
+
+	printf("\nHash table threads (%d URLs added, then searched for on every thread):\n", list->Count);
+	printf("------------------------------------------------------------------------------\n");
+	printf("%8s %16s %9s %16s %9s %8s\n", "Threads", "Add/sec", "Speedup", "Search/sec", "Speedup", "Check");
+
+	double baseAdd = 0;
+	double baseSearch = 0;
+	std::thread* workers = new std::thread[maxThreads];
+	int* counts = (int*)malloc(maxThreads * sizeof(int));
+	if (counts == NULL) {
+		printf("Insufficient memory to run benchmark. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+
+	int threads = 1;
+	while (true) {
+		CitationManager* Citations = InitializeHashTable();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int t = 0; t < threads; t++) {
+			workers[t] = std::thread(AddWorker, Citations, list, t, threads, &counts[t]);
+		}
+		int added = 0;
+		for (int t = 0; t < threads; t++) {
+			workers[t].join();
+			added += counts[t];
+		}
+		double addRate = list->Count / SecondsSince(start);
+		bool indexed = OrderedCount(&Citations->Indexes) == added;
+
+		start = std::chrono::steady_clock::now();
+		for (int t = 0; t < threads; t++) {
+			workers[t] = std::thread(SearchWorker, Citations, list, (int)((long long)list->Count * t / threads), &counts[t]);
+		}
+		bool allFound = true;
+		for (int t = 0; t < threads; t++) {
+			workers[t].join();
+			allFound = allFound && counts[t] == list->Count;
+		}
+		double searchRate = (double)list->Count * threads / SecondsSince(start);
+
+		if (threads == 1) {
+			baseAdd = addRate;
+			baseSearch = searchRate;
+		}
+		printf("%8d %16.0f %8.2fx %16.0f %8.2fx %8s\n", threads, addRate, addRate / baseAdd, searchRate,
+			searchRate / baseSearch, added == list->Count && indexed && allFound ? "ok" : "FAILED");
+
+		// Queue every citation so the library can be freed
+		Queue* CitationsToProcess = InitializeQueue();
+		for (int i = 0; i < list->Count; i++) {
+			const char* key = list->Text + list->Keys[i];
+			CitationKVP* kvp = SearchKeyHashTable(Citations, key, HashKey(Citations, key));
+			if (kvp != NULL) {
+				Enqueue(CitationsToProcess, kvp->Citation);
+			}
+		}
+		FreeLibrary(Citations, CitationsToProcess);
+
+		if (threads == maxThreads) {
+			break;
+		}
+		threads = threads * 2 > maxThreads ? maxThreads : threads * 2;
+	}
+
+	delete[] workers;
+	free(counts);
+}
+
+//
+// FUNCTION     : InsertionSortCitations
+// DESCRIPTION  : Sorts citations the way the queue used to be sorted before merge sort: each citation is inserted
+//                after walking past every citation already placed before it, which takes O(n^2) steps. Gives the same
+//                order as SortQueue, and every citation must already have its collation key built
+// PARAMETERS   : Citation** citations : Citations to sort
+//                int count            : Number of citations
+// RETURNS      : void
+//
+static void InsertionSortCitations(Citation** citations, int count) {
+	for (int i = 1; i < count; i++) {
+		Citation* citation = citations[i];
+
+		// Walk from the front past every citation that does not come strictly after this one
+		int position = 0;
+		while (position < i) {
+			Citation* placed = citations[position];
+			int length = citation->CollationLength < placed->CollationLength ? citation->CollationLength : placed->CollationLength;
+			if (memcmp(citation->CollationKey, placed->CollationKey, length + 1) > 0) {
+				break;
+			}
+			position++;
+		}
+		memmove(citations + position + 1, citations + position, (i - position) * sizeof(Citation*));
+		citations[position] = citation;
+	}
+}
+
+//
+// FUNCTION     : BenchmarkSort
+// DESCRIPTION  : Times sorting queues of 1,000 citations up to BENCHMARK_SORT_MAX with the old insertion sort and with
+//                SortQueue's merge sort, and checks that both give the same order
+// PARAMETERS   : URLList* list : URLs to build the queues from
+// RETURNS      : void
+//
+static void BenchmarkSort(URLList* list) {
+	printf("\nSorting the queue (insertion sort against merge sort):\n");
+	printf("------------------------------------------------------------------------------\n");
+	printf("%10s %16s %16s %10s %10s\n", "Citations", "Insertion sort", "Merge sort", "Speedup", "Order");
+
+	int maxSize = list->Count < BENCHMARK_SORT_MAX ? list->Count : BENCHMARK_SORT_MAX;
+	int size = maxSize < BENCHMARK_MIN_SIZE ? maxSize : BENCHMARK_MIN_SIZE;
+	while (true) {
+		CitationManager* Citations = InitializeHashTable();
+		Queue* CitationsToProcess = InitializeQueue();
+		AddURLs(Citations, CitationsToProcess, list, 0, size);
+
+		Citation** citations = (Citation**)malloc(size * sizeof(Citation*));
+		if (citations == NULL) {
+			printf("Insufficient memory to run benchmark. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		for (int i = 0; i < size; i++) {
+			citations[i] = QueueAt(CitationsToProcess, i);
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		InsertionSortCitations(citations, size);
+		double insertionSeconds = SecondsSince(start);
+
+		// Sort without the library's order, so the whole queue is merge sorted
+		start = std::chrono::steady_clock::now();
+		SortQueue(NULL, CitationsToProcess);
+		double mergeSeconds = SecondsSince(start);
+
+		bool same = true;
+		for (int i = 0; i < size; i++) {
+			same = same && QueueAt(CitationsToProcess, i) == citations[i];
+		}
+		printf("%10d %13.2f ms %13.2f ms %9.0fx %10s\n", size, insertionSeconds * 1e3, mergeSeconds * 1e3,
+			mergeSeconds > 0 ? insertionSeconds / mergeSeconds : 0.0, same ? "same" : "DIFFERENT");
+
+		free(citations);
+		FreeLibrary(Citations, CitationsToProcess);
+
+		if (size == maxSize) {
+			break;
+		}
+		size = size > maxSize / 10 ? maxSize : size * 10;
+	}
+}
+
+//
+// FUNCTION     : BenchmarkOrder
+// DESCRIPTION  : Times keeping libraries of 1,000 citations and up in sort order: adding BENCHMARK_ADD_COUNT more
+//                citations to each library (which puts them in the ordered index), and then sorting the whole queue
+//                by walking the ordered index compared with merge sorting it. Both sorts must give the same order
+// PARAMETERS   : URLList* list : URLs to build the libraries from (the last BENCHMARK_ADD_COUNT are the ones added)
+// RETURNS      : void
+//
+static void BenchmarkOrder(URLList* list) {
+	int added = list->Count / 2 < BENCHMARK_ADD_COUNT ? list->Count / 2 : BENCHMARK_ADD_COUNT;
+	int maxSize = list->Count - added;
+	if (added == 0) {
+		return;
+	}
+
+	printf("\nSorted order (adding %d citations to a library, then sorting the whole queue):\n", added);
+	printf("------------------------------------------------------------------------------\n");
+	printf("%10s %14s %18s %18s %8s\n", "Library", "Add", "Walk order", "Merge sort", "Order");
+
+	int size = maxSize < BENCHMARK_MIN_SIZE ? maxSize : BENCHMARK_MIN_SIZE;
+	while (true) {
+		CitationManager* Citations = InitializeHashTable();
+		Queue* CitationsToProcess = InitializeQueue();
+		AddURLs(Citations, CitationsToProcess, list, 0, size);
+		double addSeconds = AddURLs(Citations, CitationsToProcess, list, maxSize, added);
+		int count = size + added;
+
+		// Merge sort first (the walk does not depend on the queue's order), and keep its order to compare
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		SortQueue(NULL, CitationsToProcess);
+		double mergeSeconds = SecondsSince(start);
+
+		Citation** citations = (Citation**)malloc(count * sizeof(Citation*));
+		if (citations == NULL) {
+			printf("Insufficient memory to run benchmark. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		for (int i = 0; i < count; i++) {
+			citations[i] = QueueAt(CitationsToProcess, i);
+		}
+
+		start = std::chrono::steady_clock::now();
+		SortQueue(Citations, CitationsToProcess);
+		double walkSeconds = SecondsSince(start);
+
+		bool same = true;
+		for (int i = 0; i < count; i++) {
+			same = same && QueueAt(CitationsToProcess, i) == citations[i];
+		}
+		printf("%10d %11.0f ns %15.2f ms %15.2f ms %8s\n", size, addSeconds * 1e9 / added, walkSeconds * 1e3,
+			mergeSeconds * 1e3, same ? "same" : "DIFFERENT");
+
+		free(citations);
+		FreeLibrary(Citations, CitationsToProcess);
+
+		if (size == maxSize) {
+			break;
+		}
+		size = size > maxSize / 10 ? maxSize : size * 10;
+	}
+}
+
+//
+// FUNCTION     : BenchmarkAllocations
+// DESCRIPTION  : Counts the mallocs made importing every URL of the list into an empty library. Citations, hash
+//                table KVPs and ordered index nodes come from node pools that malloc a slab of POOL_SLAB_NODES at a
+//                time, and URLs and citation fields are copied into chunks, so the count per citation should be far
+//                below the 3 mallocs (citation, KVP and index node) each citation took before the pools. Must run
+//                before the other benchmarks, while the pools are empty
+// PARAMETERS   : URLList* list : URLs to import
+// RETURNS      : void
+//
+static void BenchmarkAllocations(URLList* list) {
+	int citationSlabs = CountNodeSlabs(POOL_CITATION);
+	int kvpSlabs = CountNodeSlabs(POOL_KVP);
+	int orderSlabs = CountNodeSlabs(POOL_ORDER);
+	int urlAllocations = CountURLPoolAllocations();
+	int storeAllocations = CountStoreAllocations();
+
+	CitationManager* Citations = InitializeHashTable();
+	Queue* CitationsToProcess = InitializeQueue();
+#if defined(_MSC_VER) && defined(_DEBUG)
+	gHeapAllocations = 0;
+	_CRT_ALLOC_HOOK previousHook = _CrtSetAllocHook(CountHeapAllocation);
+#endif
+	double seconds = AddURLs(Citations, CitationsToProcess, list, 0, list->Count);
+#if defined(_MSC_VER) && defined(_DEBUG)
+	_CrtSetAllocHook(previousHook);
+#endif
+
+	citationSlabs = CountNodeSlabs(POOL_CITATION) - citationSlabs;
+	kvpSlabs = CountNodeSlabs(POOL_KVP) - kvpSlabs;
+	orderSlabs = CountNodeSlabs(POOL_ORDER) - orderSlabs;
+	urlAllocations = CountURLPoolAllocations() - urlAllocations;
+	storeAllocations = CountStoreAllocations() - storeAllocations;
+
+	// Ordered index nodes above ORDER_POOL_LEVELS levels are malloc'd one at a time, and only they (and the head)
+	// have a link at that level
+	int tallNodes = 0;
+	OrderNode* node = Citations->Indexes.Order.Head->Next[ORDER_POOL_LEVELS];
+	while (node != NULL) {
+		tallNodes++;
+		node = node->Next[ORDER_POOL_LEVELS];
+	}
+
+	int count = list->Count;
+	int total = citationSlabs + kvpSlabs + orderSlabs + tallNodes + urlAllocations + storeAllocations;
+	printf("\nAllocations (importing all %d URLs into an empty library in %.2f s):\n", count, seconds);
+	printf("------------------------------------------------------------------------------\n");
+	printf("%-28s %10s %18s\n", "Allocator", "Mallocs", "Per citation");
+	printf("%-28s %10d %18.4f\n", "Citation node slabs", citationSlabs, (double)citationSlabs / count);
+	printf("%-28s %10d %18.4f\n", "Hash table KVP slabs", kvpSlabs, (double)kvpSlabs / count);
+	printf("%-28s %10d %18.4f\n", "Ordered index node slabs", orderSlabs, (double)orderSlabs / count);
+	printf("%-28s %10d %18.4f\n", "Tall ordered index nodes", tallNodes, (double)tallNodes / count);
+	printf("%-28s %10d %18.4f\n", "URL pool", urlAllocations, (double)urlAllocations / count);
+	printf("%-28s %10d %18.4f\n", "Citation store", storeAllocations, (double)storeAllocations / count);
+	printf("%-28s %10d %18.4f\n", "Pools and arenas", total, (double)total / count);
+#if defined(_MSC_VER) && defined(_DEBUG)
+	long long heap = gHeapAllocations;
+	printf("%-28s %10lld %18.4f\n", "Every heap allocation", heap, (double)heap / count);
+#endif
+	printf("Arrays that double when full (hash table, queue, secondary indexes) are not counted above.\n");
+	printf("Without the pools each citation took at least 3 mallocs (citation, KVP and ordered index node).\n");
+
+	FreeLibrary(Citations, CitationsToProcess);
+}
+
+//
+// FUNCTION     : benchmarkReport
+// DESCRIPTION  : Reads a file of URLs and runs every benchmark on libraries built from its different URLs
+// PARAMETERS   : const char* filename : Name of file containing line-separated URLs
+// RETURNS      : void
+//
+void benchmarkReport(const char* filename) {
+	FILE* file = NULL;
+	errno_t err = fopen_s(&file, filename, "rb");
+	if (err != 0) {
+		perror("Error opening file.");
+		return;
+	}
+
+	URLList list;
+	ReadURLList(file, &list);
+	if (list.Count == 0) {
+		printf("No URLs found in %s.\n", filename);
+		FreeURLList(&list);
+		return;
+	}
+	printf("\nBenchmark: %d different URLs in %s\n", list.Count, filename);
+	SetAccessDate(currentDate()); // Every citation of the benchmark is accessed today
+
+	BenchmarkAllocations(&list);
+	BenchmarkScaling(&list);
+	BenchmarkThreads(&list);
+	BenchmarkSort(&list);
+	BenchmarkOrder(&list);
+
+	FreeURLList(&list);
+}
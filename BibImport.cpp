@@ -0,0 +1,679 @@
+/*
+* FILE          : BibImport.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the import of BibLaTeX (.bib) files, such as the ones written by SaveFile and
+*                 exportCitationsFile. The file is read in blocks and parsed one character at a time by a state machine
+*                 that keeps its place between blocks, so only the entry being read is held in memory. Each entry with
+*                 a URL is merged with the citation stored under that URL, or added as a new citation
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <chrono>
+
+#include "Citations.h"
+
+// Define parser states
+enum BibState {
+	BIB_OUTSIDE, // Between entries, looking for '@'
+	BIB_TYPE, // Entry type after '@'
+	BIB_KEY, // Citation key, up to ','
+	BIB_FIELD, // Before a field name or the end of the entry
+	BIB_NAME, // Field name
+	BIB_EQUALS, // Before the '=' after a field name
+	BIB_VALUE, // Before a value
+	BIB_BRACED, // Value in braces
+	BIB_QUOTED, // Value in quotes
+	BIB_BARE, // Value that is a number or macro name
+	BIB_AFTER_VALUE, // After a value: '#' (concatenation), ',' or the end of the entry
+	BIB_SKIP // Body of an @comment, @string or @preamble
+};
+
+// Define fields read from entries
+enum BibField {
+	BIB_URL,
+	BIB_AUTHOR,
+	BIB_TITLE,
+	BIB_YEAR,
+	BIB_DATE,
+	BIB_URLDATE,
+	BIB_FIELD_COUNT
+};
+
+// Names of the fields read from entries (every other field is ignored)
+static const char* kBibFields[BIB_FIELD_COUNT] = { "url", "author", "title", "year", "date", "urldate" };
+
+// Define growable text
+typedef struct BibText {
+	char* Text;
+	size_t Length;
+	size_t Capacity;
+} BibText;
+
+// Define BibLaTeX parser
+typedef struct BibParser {
+	BibState State;
+	int Depth; // Brace depth inside a value or skipped entry
+	char Opener; // '{' or '(' that opened the current entry
+	char Closer; // '}' or ')' that closes the current entry
+	bool Escape; // The last character of the value was a backslash
+	int Field; // Field the current value is stored in (-1 if it is ignored)
+	BibText Type;
+	BibText Name;
+	BibText Fields[BIB_FIELD_COUNT];
+	CitationManager* Citations;
+	Queue* CitationsToProcess;
+	int Entries; // Entries read
+	int Added; // Entries added as new citations
+	int Merged; // Entries that filled in a field of a stored citation
+	int Unchanged; // Entries whose URL was stored with every field they have already filled in
+	int Skipped; // Entries without a valid URL, or that could not be parsed
+} BibParser;
+
+// Define BibLaTeX character classes
+enum BibCharClass {
+	BIB_NAME_CHAR = 1, // Allowed in an entry type, field name or bare value: letters, digits and "_-:.+/"
+	BIB_SPECIAL_CHAR = 2, // Ends a run of plain text in a braced or quoted value: "{}\"\\"
+	BIB_SPACE_CHAR = 4 // Whitespace
+};
+
+// Define BibLaTeX character table
+typedef struct BibCharTable {
+	unsigned char Class[256];
+} BibCharTable;
+
+//
+// FUNCTION     : BuildBibCharTable
+// DESCRIPTION  : Builds the class of every byte (run by the compiler)
+// PARAMETERS   : none
+// RETURNS      : BibCharTable
+//
+static constexpr BibCharTable BuildBibCharTable() {
+	BibCharTable table = {};
+	const char* name = "_-:.+/";
+	const char* special = "{}\"\\";
+
+	for (int c = 0; c < 256; c++) {
+		bool isName = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+		for (int i = 0; name[i] != '\0'; i++) {
+			isName = isName || c == name[i];
+		}
+		bool isSpecial = false;
+		for (int i = 0; special[i] != '\0'; i++) {
+			isSpecial = isSpecial || c == special[i];
+		}
+
+		bool isSpace = c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+
+		table.Class[c] = (unsigned char)((isName ? BIB_NAME_CHAR : 0) | (isSpecial ? BIB_SPECIAL_CHAR : 0) | (isSpace ? BIB_SPACE_CHAR : 0));
+	}
+	return table;
+}
+
+static constexpr BibCharTable kBibChars = BuildBibCharTable();
+
+//
+// FUNCTION     : hasBibClass
+// DESCRIPTION  : Checks if a character belongs to a class of BibLaTeX characters
+// PARAMETERS   : char c             : Character to check
+//                unsigned char type : BibCharClass to check for
+// RETURNS      : bool
+//
+static inline bool hasBibClass(char c, unsigned char type) {
+	return (kBibChars.Class[(unsigned char)c] & type) != 0;
+}
+
+//
+// FUNCTION     : ScanClass
+// DESCRIPTION  : Finds the end of a run of characters that all belong to (or all do not belong to) a class
+// PARAMETERS   : const char* data   : Block being parsed
+//                size_t i           : Start of the run
+//                size_t length      : Length of the block
+//                unsigned char type : BibCharClass of the run
+//                bool inClass       : true to scan characters of the class, false to scan characters outside it
+// RETURNS      : size_t             : Index of the first character after the run
+//
+static inline size_t ScanClass(const char* data, size_t i, size_t length, unsigned char type, bool inClass) {
+	while (i < length && hasBibClass(data[i], type) == inClass) {
+		i++;
+	}
+	return i;
+}
+
+//
+// FUNCTION     : AppendText
+// DESCRIPTION  : Appends characters to a growable text, keeping it null-terminated
+// PARAMETERS   : BibText* text     : Text to append to
+//                const char* chars : Characters to append
+//                size_t length     : Number of characters
+// RETURNS      : void
+//
+static void AppendText(BibText* text, const char* chars, size_t length) {
+	if (text->Length + length + 1 > text->Capacity) {
+		size_t capacity = text->Capacity == 0 ? 64 : text->Capacity;
+		while (text->Length + length + 1 > capacity) {
+			capacity *= 2;
+		}
+		char* grown = (char*)realloc(text->Text, capacity);
+		if (grown == NULL) {
+			printf("Insufficient memory to import file. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		text->Text = grown;
+		text->Capacity = capacity;
+	}
+	memcpy(text->Text + text->Length, chars, length);
+	text->Length += length;
+	text->Text[text->Length] = '\0';
+}
+
+//
+// FUNCTION     : AppendLower
+// DESCRIPTION  : Appends characters to a growable text in lower case (entry types and field names are not case sensitive)
+// PARAMETERS   : BibText* text     : Text to append to
+//                const char* chars : Characters to append
+//                size_t length     : Number of characters
+// RETURNS      : void
+//
+static void AppendLower(BibText* text, const char* chars, size_t length) {
+	size_t start = text->Length;
+	AppendText(text, chars, length);
+	for (size_t i = start; i < text->Length; i++) {
+		text->Text[i] = (char)tolower((unsigned char)text->Text[i]);
+	}
+}
+
+//
+// FUNCTION     : ClearText
+// DESCRIPTION  : Empties a growable text, keeping its memory for the next entry
+// PARAMETERS   : BibText* text : Text to empty
+// RETURNS      : void
+//
+static void ClearText(BibText* text) {
+	text->Length = 0;
+	if (text->Text != NULL) {
+		text->Text[0] = '\0';
+	}
+}
+
+//
+// FUNCTION     : NormalizeText
+// DESCRIPTION  : Replaces every run of whitespace (including line breaks inside a value) with one space and trims both
+//                ends, like BibTeX does
+// PARAMETERS   : BibText* text : Text to normalize
+// RETURNS      : void
+//
+static void NormalizeText(BibText* text) {
+	size_t out = 0;
+	bool space = false;
+
+	for (size_t i = 0; i < text->Length; i++) {
+		if (hasBibClass(text->Text[i], BIB_SPACE_CHAR)) {
+			space = out > 0;
+			continue;
+		}
+		if (space) {
+			text->Text[out++] = ' ';
+			space = false;
+		}
+		text->Text[out++] = text->Text[i];
+	}
+	text->Length = out;
+	if (text->Text != NULL) {
+		text->Text[out] = '\0';
+	}
+}
+
+//
+// FUNCTION     : FieldText
+// DESCRIPTION  : Returns the text of a field of the current entry ("" if the entry does not have it)
+// PARAMETERS   : BibParser* parser : Parser reading the entry
+//                BibField field    : Field to return
+// RETURNS      : const char*
+//
+static const char* FieldText(BibParser* parser, BibField field) {
+	return parser->Fields[field].Length > 0 ? parser->Fields[field].Text : "";
+}
+
+//
+// FUNCTION     : EntryYear
+// DESCRIPTION  : Reads the year of the current entry from its year field, or the start of its date field
+// PARAMETERS   : BibParser* parser : Parser reading the entry
+// RETURNS      : int               : The year, or 0 if the entry has none
+//
+static int EntryYear(BibParser* parser) {
+	const char* year = parser->Fields[BIB_YEAR].Length > 0 ? FieldText(parser, BIB_YEAR) : FieldText(parser, BIB_DATE);
+	for (int i = 0; i < 4; i++) {
+		if (!isdigit((unsigned char)year[i])) {
+			return 0;
+		}
+	}
+	if (isdigit((unsigned char)year[4])) {
+		return 0;
+	}
+	return atoi(year);
+}
+
+//
+// FUNCTION     : EndEntry
+// DESCRIPTION  : Stores the entry that was just read. If a citation with the same URL is stored, the entry fills in
+//                the author, title and year that the citation is missing (data already in the library is kept).
+//                Otherwise the entry is added as a new citation to the hash table and the queue
+// PARAMETERS   : BibParser* parser : Parser that read the entry
+// RETURNS      : void
+//
+static void EndEntry(BibParser* parser) {
+	parser->Entries++;
+	for (int i = 0; i < BIB_FIELD_COUNT; i++) {
+		NormalizeText(&parser->Fields[i]);
+	}
+
+	const char* url = FieldText(parser, BIB_URL);
+	size_t length = parser->Fields[BIB_URL].Length;
+	if (!isValidURL(url, length)) {
+		parser->Skipped++;
+		return;
+	}
+
+	// Canonicalize and hash the URL once
+	char stackBuffer[LINE_SIZE];
+	char* canonical = length < LINE_SIZE ? stackBuffer : (char*)malloc(length + 1);
+	if (canonical == NULL) {
+		printf("Insufficient memory to import file. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	canonicalizeURL(url, length, canonical);
+	unsigned long long hash = HashKey(parser->Citations, URLKey(canonical));
+
+	const char* author = FieldText(parser, BIB_AUTHOR);
+	const char* title = FieldText(parser, BIB_TITLE);
+	int year = EntryYear(parser);
+	PackedDate date = parseDate(FieldText(parser, BIB_URLDATE));
+
+	CitationKVP* kvp = SearchKeyHashTable(parser->Citations, URLKey(canonical), hash);
+	if (kvp != NULL) {
+		// Fill in what the stored citation is missing, reindexing it if anything changes
+		Citation* citation = kvp->Citation;
+		bool setAuthor = author[0] != '\0' && GetCitationAuthor(citation)[0] == '\0';
+		bool setTitle = title[0] != '\0' && GetCitationTitle(citation)[0] == '\0';
+		bool setYear = year != 0 && GetCitationYear(citation) == 0;
+		if (setAuthor || setTitle || setYear) {
+			UnindexCitation(&parser->Citations->Indexes, citation);
+			if (setAuthor) {
+				SetCitationAuthor(citation, author);
+			}
+			if (setTitle) {
+				SetCitationTitle(citation, title);
+			}
+			if (setYear) {
+				SetCitationYear(citation, year);
+			}
+			IndexCitation(&parser->Citations->Indexes, citation);
+			parser->Merged++;
+		}
+		else {
+			parser->Unchanged++;
+		}
+	}
+	else {
+		// Set the fields before inserting, so the citation is indexed under them
+		Citation* citation = InitializeCitation(canonical);
+		SetCitationAuthor(citation, author);
+		SetCitationTitle(citation, title);
+		SetCitationYear(citation, year);
+		if (date != 0) {
+			SetCitationDateAccessed(citation, date);
+		}
+		if (InsertHashTableWithHash(parser->Citations, citation, hash)) {
+			Enqueue(parser->CitationsToProcess, citation);
+			parser->Added++;
+		}
+		else {
+			FreeCitation(citation);
+			parser->Skipped++;
+		}
+	}
+
+	if (canonical != stackBuffer) {
+		free(canonical);
+	}
+}
+
+//
+// FUNCTION     : BeginEntry
+// DESCRIPTION  : Starts reading an entry once its type and opening brace or parenthesis have been read
+// PARAMETERS   : BibParser* parser : Parser reading the file
+//                char opener       : '{' or '(' that opened the entry
+// RETURNS      : void
+//
+static void BeginEntry(BibParser* parser, char opener) {
+	parser->Opener = opener;
+	parser->Closer = opener == '{' ? '}' : ')';
+
+	// Comments, string definitions and preambles are not citations
+	const char* type = parser->Type.Length > 0 ? parser->Type.Text : "";
+	if (strcmp(type, "comment") == 0 || strcmp(type, "string") == 0 || strcmp(type, "preamble") == 0) {
+		parser->Depth = 1;
+		parser->State = BIB_SKIP;
+		return;
+	}
+
+	for (int i = 0; i < BIB_FIELD_COUNT; i++) {
+		ClearText(&parser->Fields[i]);
+	}
+	parser->State = BIB_KEY;
+}
+
+//
+// FUNCTION     : BeginValue
+// DESCRIPTION  : Picks the field a value is stored in from the field name that was just read
+// PARAMETERS   : BibParser* parser : Parser reading the entry
+// RETURNS      : void
+//
+static void BeginValue(BibParser* parser) {
+	parser->Field = -1;
+	for (int i = 0; i < BIB_FIELD_COUNT; i++) {
+		if (strcmp(parser->Name.Text, kBibFields[i]) == 0) {
+			parser->Field = i;
+			ClearText(&parser->Fields[i]);
+			break;
+		}
+	}
+	parser->State = BIB_VALUE;
+}
+
+//
+// FUNCTION     : AppendValue
+// DESCRIPTION  : Appends characters to the current value (ignored if the value's field is not read)
+// PARAMETERS   : BibParser* parser : Parser reading the entry
+//                const char* chars : Characters to append
+//                size_t length     : Number of characters
+// RETURNS      : void
+//
+static inline void AppendValue(BibParser* parser, const char* chars, size_t length) {
+	if (parser->Field >= 0 && length > 0) {
+		AppendText(&parser->Fields[parser->Field], chars, length);
+	}
+}
+
+//
+// FUNCTION     : ParseBlock
+// DESCRIPTION  : Feeds a block of the file to the parser. Entries are stored as soon as they end, and an entry that
+//                continues past the block is finished by the next block. Plain text inside a value is copied in runs,
+//                and the text between entries is skipped with memchr
+// PARAMETERS   : BibParser* parser : Parser reading the file
+//                const char* data  : Block of the file
+//                size_t length     : Length of the block
+// RETURNS      : void
+//
+static void ParseBlock(BibParser* parser, const char* data, size_t length) {
+	size_t i = 0;
+
+	while (i < length) {
+		char c = data[i];
+
+		switch (parser->State) {
+		case BIB_OUTSIDE: {
+			const char* at = (const char*)memchr(data + i, '@', length - i);
+			if (at == NULL) {
+				return;
+			}
+			i = at - data + 1;
+			ClearText(&parser->Type);
+			parser->State = BIB_TYPE;
+			continue;
+		}
+
+		case BIB_TYPE:
+			if (hasBibClass(c, BIB_NAME_CHAR)) {
+				size_t end = ScanClass(data, i, length, BIB_NAME_CHAR, true);
+				AppendLower(&parser->Type, data + i, end - i);
+				i = end;
+				continue;
+			}
+			else if (c == '{' || c == '(') {
+				BeginEntry(parser, c);
+			}
+			else if (!hasBibClass(c, BIB_SPACE_CHAR)) {
+				parser->State = BIB_OUTSIDE; // Not an entry (e.g. an e-mail address in a comment)
+				continue;
+			}
+			break;
+
+		case BIB_KEY:
+			if (c == ',') {
+				parser->State = BIB_FIELD;
+			}
+			else if (c == parser->Closer) {
+				EndEntry(parser);
+				parser->State = BIB_OUTSIDE;
+			}
+			break;
+
+		case BIB_FIELD:
+			if (c == parser->Closer) {
+				EndEntry(parser);
+				parser->State = BIB_OUTSIDE;
+			}
+			else if (hasBibClass(c, BIB_NAME_CHAR)) {
+				ClearText(&parser->Name);
+				parser->State = BIB_NAME;
+				continue;
+			}
+			else if (!hasBibClass(c, BIB_SPACE_CHAR) && c != ',') {
+				parser->Skipped++;
+				parser->State = BIB_OUTSIDE;
+			}
+			break;
+
+		case BIB_NAME:
+			if (hasBibClass(c, BIB_NAME_CHAR)) {
+				size_t end = ScanClass(data, i, length, BIB_NAME_CHAR, true);
+				AppendLower(&parser->Name, data + i, end - i);
+				i = end;
+				continue;
+			}
+			parser->State = BIB_EQUALS;
+			continue;
+
+		case BIB_EQUALS:
+			if (c == '=') {
+				BeginValue(parser);
+			}
+			else if (!hasBibClass(c, BIB_SPACE_CHAR)) {
+				parser->Skipped++;
+				parser->State = BIB_OUTSIDE;
+			}
+			break;
+
+		case BIB_VALUE:
+			if (c == '{') {
+				parser->Depth = 1;
+				parser->State = BIB_BRACED;
+			}
+			else if (c == '"') {
+				parser->Depth = 0;
+				parser->State = BIB_QUOTED;
+			}
+			else if (hasBibClass(c, BIB_NAME_CHAR)) {
+				parser->State = BIB_BARE;
+				continue;
+			}
+			else if (!hasBibClass(c, BIB_SPACE_CHAR)) {
+				parser->Skipped++;
+				parser->State = BIB_OUTSIDE;
+			}
+			break;
+
+		case BIB_BRACED:
+		case BIB_QUOTED: {
+			if (parser->Escape) {
+				AppendValue(parser, &c, 1);
+				parser->Escape = false;
+				break;
+			}
+
+			// Copy the run of plain text up to the next brace, quote or backslash
+			size_t end = ScanClass(data, i, length, BIB_SPECIAL_CHAR, false);
+			if (end > i) {
+				AppendValue(parser, data + i, end - i);
+				i = end;
+				continue;
+			}
+
+			if (c == '\\') {
+				parser->Escape = true;
+				AppendValue(parser, &c, 1);
+			}
+			else if (c == '{') {
+				parser->Depth++;
+				AppendValue(parser, &c, 1);
+			}
+			else if (c == '}' && parser->State == BIB_BRACED && parser->Depth == 1) {
+				parser->State = BIB_AFTER_VALUE;
+			}
+			else if (c == '}') {
+				if (parser->Depth > 0) {
+					parser->Depth--;
+				}
+				AppendValue(parser, &c, 1);
+			}
+			else if (c == '"' && parser->State == BIB_QUOTED && parser->Depth == 0) {
+				parser->State = BIB_AFTER_VALUE;
+			}
+			else {
+				AppendValue(parser, &c, 1);
+			}
+			break;
+		}
+
+		case BIB_BARE:
+			if (hasBibClass(c, BIB_NAME_CHAR)) {
+				size_t end = ScanClass(data, i, length, BIB_NAME_CHAR, true);
+				AppendValue(parser, data + i, end - i);
+				i = end;
+				continue;
+			}
+			parser->State = BIB_AFTER_VALUE;
+			continue;
+
+		case BIB_AFTER_VALUE:
+			if (c == '#') {
+				parser->State = BIB_VALUE; // The next value is appended to this one
+			}
+			else if (c == ',') {
+				parser->State = BIB_FIELD;
+			}
+			else if (c == parser->Closer) {
+				EndEntry(parser);
+				parser->State = BIB_OUTSIDE;
+			}
+			else if (!hasBibClass(c, BIB_SPACE_CHAR)) {
+				parser->Skipped++;
+				parser->State = BIB_OUTSIDE;
+			}
+			break;
+
+		case BIB_SKIP:
+			if (c == parser->Opener) {
+				parser->Depth++;
+			}
+			else if (c == parser->Closer && --parser->Depth == 0) {
+				parser->State = BIB_OUTSIDE;
+			}
+			break;
+		}
+		i++;
+	}
+}
+
+//
+// FUNCTION     : isBibFile
+// DESCRIPTION  : Checks if a file is a BibLaTeX file: its first character that is not whitespace starts an entry ('@')
+//                or a comment ('%'). The whitespace before it is consumed, and the character itself is left unread
+// PARAMETERS   : FILE* file : File to check (nothing may have been read from it)
+// RETURNS      : bool
+//
+bool isBibFile(FILE* file) {
+	int c = getc(file);
+	while (c != EOF && isspace(c)) {
+		c = getc(file);
+	}
+	if (c == EOF) {
+		return false;
+	}
+	ungetc(c, file);
+	return c == '@' || c == '%';
+}
+
+//
+// FUNCTION     : StoreBibData
+// DESCRIPTION  : Reads the entries of a BibLaTeX file into the library. Entries are matched to stored citations by
+//                their canonical URL: a stored citation keeps its data and only gains what it is missing, and other
+//                entries become new citations in the hash table and the queue of citations to process. Entries without
+//                a valid URL are skipped
+// PARAMETERS   : FILE* file                 : BibLaTeX file (not closed)
+//                CitationManager* Citations : Hash table containing citations
+//                Queue* CitationsToProcess  : Queue to store citations that need to be processed
+// RETURNS      : bool                       : false if the file could not be read to the end
+//
+bool StoreBibData(FILE* file, CitationManager* Citations, Queue* CitationsToProcess) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	BibParser* parser = (BibParser*)calloc(1, sizeof(BibParser));
+	char* block = (char*)malloc(READ_BLOCK_SIZE);
+	if (parser == NULL || block == NULL) {
+		printf("Insufficient memory to import file. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	parser->State = BIB_OUTSIDE;
+	parser->Field = -1;
+	parser->Citations = Citations;
+	parser->CitationsToProcess = CitationsToProcess;
+	SetAccessDate(currentDate()); // Entries without a urldate are accessed today
+
+	double bytes = 0;
+	size_t read = 0;
+	while ((read = fread(block, 1, READ_BLOCK_SIZE, file)) > 0) {
+		ParseBlock(parser, block, read);
+		bytes += (double)read;
+	}
+	if (parser->State != BIB_OUTSIDE && parser->State != BIB_SKIP) {
+		parser->Skipped++; // The file ended inside an entry
+	}
+
+	bool error = ferror(file) != 0;
+	if (error) {
+		printf("Error reading file.\n");
+	}
+
+	// Print what was read
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double megabytes = bytes / (1024 * 1024);
+	printf("%d entries read: %d citations added, %d merged with stored citations.\n", parser->Entries, parser->Added, parser->Merged);
+	if (parser->Unchanged > 0) {
+		printf("%d entries were already stored with nothing new to add.\n", parser->Unchanged);
+	}
+	if (parser->Skipped > 0) {
+		printf("%d entries had no valid URL or could not be read and were skipped.\n", parser->Skipped);
+	}
+	if (seconds > 0) {
+		printf("Read %.1f MB in %.2f seconds (%.0f MB/s).\n", megabytes, seconds, megabytes / seconds);
+	}
+
+	// Free the parser
+	free(parser->Type.Text);
+	free(parser->Name.Text);
+	for (int i = 0; i < BIB_FIELD_COUNT; i++) {
+		free(parser->Fields[i].Text);
+	}
+	free(parser);
+	free(block);
+
+	return !error;
+}
@@ -0,0 +1,565 @@
+/*
+* FILE          : CitationStore.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the citation store, which keeps the fields of every citation in columns (one
+*                 array per field, one row per citation) with the author and title text and the collation keys in a
+*                 shared string arena that reclaims replaced text a generation of chunks at a time.
+*                 Citations are handles to a row, and their fields are read and changed through the functions here
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <mutex>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "Citations.h"
+
+// Define constants
+#define STORE_SIZE			1024	// Number of rows in the first block of the store (each block is twice the last)
+#define STORE_SHIFT			10		// log2 of STORE_SIZE
+#define STORE_MAX_BLOCKS	21		// Most blocks whose rows can all be numbered with an int
+#define STORE_CHUNK_SIZE	65536	// Bytes of string storage allocated at a time
+#define STORE_COMPACT_MIN	65536	// Bytes of replaced strings needed before the arena is compacted
+
+// Define block of string storage
+typedef struct StoreChunk {
+	struct StoreChunk* Next;
+	size_t Used;
+	size_t Size;
+	char* Data;
+} StoreChunk;
+
+// Define block of rows
+// Every column of a block of rows, allocated together. Block b holds STORE_SIZE << b rows
+typedef struct StoreBlock {
+	Citation** Handles; // Citation using each row (NULL if the row is free)
+	const char** URLs; // Canonical URLs (interned in the URL pool, see AllocateCitationRow)
+	const char** Authors;
+	const char** Titles;
+	int* Years;
+	PackedDate* DatesAccessed;
+	unsigned char* States;
+} StoreBlock;
+
+// Define Citation Store
+// Row i of every column holds a field of the citation whose Row is i. The store grows by adding a block twice the
+// size of the last one, and blocks never move, so fields can be read without StoreLock on one thread while another
+// thread creates citations (a citation's row is handed to other threads through a lock, such as a hash table shard's).
+// Strings and collation keys are bump-allocated from the chunks of the current generation. Once more of the arena is
+// taken by replaced strings than by live ones, the live strings are copied into a new generation and every chunk of
+// the old one is freed at once, so text returned by GetCitationAuthor or GetCitationTitle (and collation keys) is
+// only valid until the next author or title is changed.
+// There is one store for the whole process, like the URL pool and node pools: a citation is a handle that is read
+// through its row alone, so the accessors do not need the hash table that holds it (streamed citations are in none)
+typedef struct CitationStore {
+	StoreBlock Blocks[STORE_MAX_BLOCKS];
+	int BlockCount;
+	int* FreeRows; // Rows of freed citations, reused before new rows (only used with StoreLock held)
+	int FreeCount;
+	int Count; // Number of rows used so far (including free ones)
+	int Capacity;
+	StoreChunk* Chunks; // Chunks of the current generation (newest first)
+	size_t ChunkBytes; // Bytes used in the chunks of the current generation
+	size_t LiveBytes; // Bytes of those used by the current author and title of a citation
+	PackedDate AccessDate; // Date accessed given to new citations (0 until the first citation is created)
+	int Allocations; // Number of mallocs and reallocs of blocks, free rows and chunks
+} CitationStore;
+
+// Store shared by every citation (StoreLock is held while rows, chunks or strings are added or removed)
+static CitationStore Store = {};
+static std::mutex StoreLock;
+
+//
+// FUNCTION     : FindRow
+// DESCRIPTION  : Finds the block holding a row of the store and the row's place in it
+// PARAMETERS   : int row     : Row of a citation
+//                int* offset : Stores the place of the row in its block
+// RETURNS      : StoreBlock*
+//
+static inline StoreBlock* FindRow(int row, int* offset) {
+	// Block b starts at row STORE_SIZE * (2^b - 1), so row + STORE_SIZE has its highest bit at b + STORE_SHIFT
+	unsigned int n = (unsigned int)row + STORE_SIZE;
+#if defined(_MSC_VER)
+	unsigned long highest;
+	_BitScanReverse(&highest, n);
+#else
+	unsigned int highest = 31 - (unsigned int)__builtin_clz(n);
+#endif
+	int block = (int)highest - STORE_SHIFT;
+	*offset = (int)(n - ((unsigned int)STORE_SIZE << block));
+	return &Store.Blocks[block];
+}
+
+//
+// FUNCTION     : GrowColumn
+// DESCRIPTION  : Allocates a block of the store or resizes its free rows, exiting if there is not enough memory
+// PARAMETERS   : void* column  : Memory to resize (NULL for a new block)
+//                size_t size   : Bytes needed
+// RETURNS      : void*
+//
+static void* GrowColumn(void* column, size_t size) {
+	void* grown = realloc(column, size);
+	if (grown == NULL) {
+		printf("Insufficient memory to create citation. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	Store.Allocations++;
+	return grown;
+}
+
+//
+// FUNCTION     : GrowStore
+// DESCRIPTION  : Adds a block of rows twice the size of the last one, so the store holds twice as many rows. The
+//                rows already in the store do not move (StoreLock must be held)
+// PARAMETERS   : none
+// RETURNS      : void
+//
+static void GrowStore(void) {
+	if (Store.BlockCount == STORE_MAX_BLOCKS) {
+		printf("Insufficient memory to create citation. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	size_t rows = (size_t)STORE_SIZE << Store.BlockCount;
+
+	// One allocation holds every column of the block, widest fields first so each column stays aligned
+	char* memory = (char*)GrowColumn(NULL, rows * (4 * sizeof(char*) + sizeof(int) + sizeof(PackedDate) + 1));
+	StoreBlock* block = &Store.Blocks[Store.BlockCount];
+	block->Handles = (Citation**)memory;
+	block->URLs = (const char**)(block->Handles + rows);
+	block->Authors = block->URLs + rows;
+	block->Titles = block->Authors + rows;
+	block->Years = (int*)(block->Titles + rows);
+	block->DatesAccessed = (PackedDate*)(block->Years + rows);
+	block->States = (unsigned char*)(block->DatesAccessed + rows);
+	Store.BlockCount++;
+
+	Store.Capacity += (int)rows;
+	Store.FreeRows = (int*)GrowColumn(Store.FreeRows, Store.Capacity * sizeof(int));
+}
+
+//
+// FUNCTION     : CopyBytes
+// DESCRIPTION  : Copies bytes into the current generation of the string arena (StoreLock must be held)
+// PARAMETERS   : const void* data : Bytes to copy
+//                size_t size      : Number of bytes
+// RETURNS      : char*            : Copy of the bytes
+//
+static char* CopyBytes(const void* data, size_t size) {
+	if (Store.Chunks == NULL || Store.Chunks->Used + size > Store.Chunks->Size) {
+		size_t chunkSize = size > STORE_CHUNK_SIZE ? size : STORE_CHUNK_SIZE;
+		StoreChunk* chunk = (StoreChunk*)malloc(sizeof(StoreChunk) + chunkSize);
+		if (chunk == NULL) {
+			printf("Insufficient memory to store citation data. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		chunk->Data = (char*)(chunk + 1);
+		chunk->Used = 0;
+		chunk->Size = chunkSize;
+		chunk->Next = Store.Chunks;
+		Store.Chunks = chunk;
+		Store.Allocations++;
+	}
+
+	char* copy = Store.Chunks->Data + Store.Chunks->Used;
+	Store.Chunks->Used += size;
+	Store.ChunkBytes += size;
+	Store.LiveBytes += size;
+	memcpy(copy, data, size);
+	return copy;
+}
+
+//
+// FUNCTION     : CopyString
+// DESCRIPTION  : Copies a string into the current generation of the string arena (StoreLock must be held)
+// PARAMETERS   : const char* str : String to copy (must not be empty)
+// RETURNS      : const char*     : Copy of the string
+//
+static const char* CopyString(const char* str) {
+	return CopyBytes(str, strlen(str) + 1);
+}
+
+//
+// FUNCTION     : FreeChunks
+// DESCRIPTION  : Frees a list of string arena chunks
+// PARAMETERS   : StoreChunk* chunks : First chunk of the list
+// RETURNS      : void
+//
+static void FreeChunks(StoreChunk* chunks) {
+	StoreChunk* current = chunks;
+	StoreChunk* next = NULL;
+	while (current != NULL) {
+		next = current->Next;
+		free(current);
+		current = next;
+	}
+}
+
+//
+// FUNCTION     : CompactStrings
+// DESCRIPTION  : Starts a new generation of the string arena: copies the author, title and collation key of every
+//                citation into new chunks and frees every chunk of the old generation (StoreLock must be held)
+// PARAMETERS   : none
+// RETURNS      : void
+//
+static void CompactStrings(void) {
+	StoreChunk* oldChunks = Store.Chunks;
+	Store.Chunks = NULL;
+	Store.ChunkBytes = 0;
+	Store.LiveBytes = 0;
+
+	int i = 0;
+	for (int row = 0; row < Store.Count; row++) {
+		StoreBlock* block = FindRow(row, &i);
+		if (block->Handles[i] == NULL) {
+			continue; // Free row
+		}
+		if (block->Authors[i][0] != '\0') {
+			block->Authors[i] = CopyString(block->Authors[i]);
+		}
+		if (block->Titles[i][0] != '\0') {
+			block->Titles[i] = CopyString(block->Titles[i]);
+		}
+		Citation* citation = block->Handles[i];
+		if (citation->CollationKey != NULL) {
+			citation->CollationKey = (unsigned char*)CopyBytes(citation->CollationKey, citation->CollationLength + 1);
+		}
+	}
+
+	FreeChunks(oldChunks);
+}
+
+//
+// FUNCTION     : DropString
+// DESCRIPTION  : Marks a string of the arena as replaced (StoreLock must be held)
+// PARAMETERS   : const char* str : String no longer used by any citation
+// RETURNS      : void
+//
+static void DropString(const char* str) {
+	if (str[0] != '\0') {
+		Store.LiveBytes -= strlen(str) + 1;
+	}
+}
+
+//
+// FUNCTION     : ReplaceString
+// DESCRIPTION  : Changes a string field of the store, starting a new generation of the string arena once more of it
+//                is taken by replaced strings than by live ones
+// PARAMETERS   : const char** field  : Field to change (a row of the author or title column)
+//                const char* str     : New string (copied into the arena; NULL is stored as an empty string)
+// RETURNS      : void
+//
+static void ReplaceString(const char** field, const char* str) {
+	std::lock_guard<std::mutex> guard(StoreLock);
+
+	// Copy the new string before dropping the old one, since it may be the old one
+	const char* old = *field;
+	*field = str == NULL || str[0] == '\0' ? "" : CopyString(str);
+	DropString(old);
+
+	size_t replaced = Store.ChunkBytes - Store.LiveBytes;
+	if (replaced >= STORE_COMPACT_MIN && replaced > Store.LiveBytes) {
+		CompactStrings();
+	}
+}
+
+//
+// FUNCTION     : AllocateCitationRow
+// DESCRIPTION  : Gives a citation a row of the store with an empty author and title, no year, the pending state and
+//                the current access date (see SetAccessDate)
+// PARAMETERS   : Citation* citation  : Citation to give a row to
+//                const char* url     : Canonical URL of the citation (interned in the URL pool, or kept valid by
+//                                      the caller until the row is released)
+// RETURNS      : int                 : Row of the citation
+//
+int AllocateCitationRow(Citation* citation, const char* url) {
+	std::lock_guard<std::mutex> guard(StoreLock);
+
+	int row = 0;
+	if (Store.FreeCount > 0) {
+		Store.FreeCount--;
+		row = Store.FreeRows[Store.FreeCount];
+	}
+	else {
+		if (Store.Count == Store.Capacity) {
+			GrowStore();
+		}
+		row = Store.Count;
+		Store.Count++;
+	}
+
+	int i = 0;
+	StoreBlock* block = FindRow(row, &i);
+	block->Handles[i] = citation;
+	block->URLs[i] = url;
+	block->Authors[i] = "";
+	block->Titles[i] = "";
+	block->Years[i] = 0;
+	if (Store.AccessDate == 0) {
+		Store.AccessDate = currentDate();
+	}
+	block->DatesAccessed[i] = Store.AccessDate;
+	block->States[i] = CITATION_PENDING;
+	return row;
+}
+
+//
+// FUNCTION     : ReleaseCitationRow
+// DESCRIPTION  : Frees the row of a citation so a new citation can use it
+// PARAMETERS   : Citation* citation : Citation being freed
+// RETURNS      : void
+//
+void ReleaseCitationRow(Citation* citation) {
+	std::lock_guard<std::mutex> guard(StoreLock);
+
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	DropString(block->Authors[i]);
+	DropString(block->Titles[i]);
+	if (citation->CollationKey != NULL) {
+		Store.LiveBytes -= citation->CollationLength + 1;
+		citation->CollationKey = NULL;
+	}
+	block->Handles[i] = NULL;
+	block->Authors[i] = "";
+	block->Titles[i] = "";
+	Store.FreeRows[Store.FreeCount] = citation->Row;
+	Store.FreeCount++;
+}
+
+//
+// FUNCTION     : StoreCollationKey
+// DESCRIPTION  : Copies the collation key of a citation into the string arena and gives it to the citation
+// PARAMETERS   : Citation* citation         : Citation the key belongs to (must not have a key)
+//                const unsigned char* key   : Key, including its end marker
+//                int length                 : Length of the key, not counting the end marker
+// RETURNS      : void
+//
+void StoreCollationKey(Citation* citation, const unsigned char* key, int length) {
+	std::lock_guard<std::mutex> guard(StoreLock);
+	citation->CollationKey = (unsigned char*)CopyBytes(key, length + 1);
+	citation->CollationLength = length;
+}
+
+//
+// FUNCTION     : DropCollationKey
+// DESCRIPTION  : Discards the collation key of a citation, leaving its bytes to be reclaimed with the next generation
+//                of the string arena
+// PARAMETERS   : Citation* citation : Citation whose key is discarded
+// RETURNS      : void
+//
+void DropCollationKey(Citation* citation) {
+	std::lock_guard<std::mutex> guard(StoreLock);
+	if (citation->CollationKey != NULL) {
+		Store.LiveBytes -= citation->CollationLength + 1;
+	}
+	citation->CollationKey = NULL;
+	citation->CollationLength = 0;
+}
+
+//
+// FUNCTION     : GetCitationURL
+// DESCRIPTION  : Returns the canonical URL of a citation
+// PARAMETERS   : Citation* citation : Citation to read
+// RETURNS      : const char*
+//
+const char* GetCitationURL(Citation* citation) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	return block->URLs[i];
+}
+
+//
+// FUNCTION     : GetCitationAuthor
+// DESCRIPTION  : Returns the author of a citation (empty if it has none)
+// PARAMETERS   : Citation* citation : Citation to read
+// RETURNS      : const char*
+//
+const char* GetCitationAuthor(Citation* citation) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	return block->Authors[i];
+}
+
+//
+// FUNCTION     : SetCitationAuthor
+// DESCRIPTION  : Changes the author of a citation. The citation must not be indexed (see UnindexCitation)
+// PARAMETERS   : Citation* citation  : Citation to change
+//                const char* author  : New author (copied into the store; NULL clears it)
+// RETURNS      : void
+//
+void SetCitationAuthor(Citation* citation, const char* author) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	ReplaceString(&block->Authors[i], author);
+}
+
+//
+// FUNCTION     : GetCitationTitle
+// DESCRIPTION  : Returns the title of a citation (empty if it has none)
+// PARAMETERS   : Citation* citation : Citation to read
+// RETURNS      : const char*
+//
+const char* GetCitationTitle(Citation* citation) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	return block->Titles[i];
+}
+
+//
+// FUNCTION     : SetCitationTitle
+// DESCRIPTION  : Changes the title of a citation. The citation must not be indexed (see UnindexCitation)
+// PARAMETERS   : Citation* citation  : Citation to change
+//                const char* title   : New title (copied into the store; NULL clears it)
+// RETURNS      : void
+//
+void SetCitationTitle(Citation* citation, const char* title) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	ReplaceString(&block->Titles[i], title);
+}
+
+//
+// FUNCTION     : GetCitationYear
+// DESCRIPTION  : Returns the year of a citation (0 if it has none)
+// PARAMETERS   : Citation* citation : Citation to read
+// RETURNS      : int
+//
+int GetCitationYear(Citation* citation) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	return block->Years[i];
+}
+
+//
+// FUNCTION     : SetCitationYear
+// DESCRIPTION  : Changes the year of a citation. The citation must not be indexed (see UnindexCitation)
+// PARAMETERS   : Citation* citation  : Citation to change
+//                int year            : New year (0 clears it)
+// RETURNS      : void
+//
+void SetCitationYear(Citation* citation, int year) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	block->Years[i] = year;
+}
+
+//
+// FUNCTION     : GetCitationDateAccessed
+// DESCRIPTION  : Returns the date a citation was accessed (see formatDate)
+// PARAMETERS   : Citation* citation : Citation to read
+// RETURNS      : PackedDate
+//
+PackedDate GetCitationDateAccessed(Citation* citation) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	return block->DatesAccessed[i];
+}
+
+//
+// FUNCTION     : SetCitationDateAccessed
+// DESCRIPTION  : Changes the date a citation was accessed
+// PARAMETERS   : Citation* citation  : Citation to change
+//                PackedDate date     : New date
+// RETURNS      : void
+//
+void SetCitationDateAccessed(Citation* citation, PackedDate date) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	block->DatesAccessed[i] = date;
+}
+
+//
+// FUNCTION     : SetAccessDate
+// DESCRIPTION  : Sets the date accessed given to citations created from now on. Called once at the start of every
+//                import or added citation, so creating a citation never has to read the clock
+// PARAMETERS   : PackedDate date : Date accessed (see currentDate)
+// RETURNS      : void
+//
+void SetAccessDate(PackedDate date) {
+	std::lock_guard<std::mutex> guard(StoreLock);
+	Store.AccessDate = date;
+}
+
+//
+// FUNCTION     : GetCitationState
+// DESCRIPTION  : Returns where a citation is in its lifecycle
+// PARAMETERS   : Citation* citation : Citation to read
+// RETURNS      : CitationState
+//
+CitationState GetCitationState(Citation* citation) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	return (CitationState)block->States[i];
+}
+
+//
+// FUNCTION     : SetCitationState
+// DESCRIPTION  : Changes where a citation is in its lifecycle
+// PARAMETERS   : Citation* citation    : Citation to change
+//                CitationState state   : New state
+// RETURNS      : void
+//
+void SetCitationState(Citation* citation, CitationState state) {
+	int i = 0;
+	StoreBlock* block = FindRow(citation->Row, &i);
+	block->States[i] = (unsigned char)state;
+}
+
+//
+// FUNCTION     : CountCitationsMissingData
+// DESCRIPTION  : Counts the pending citations without an author, title or year by sweeping the store's columns
+// PARAMETERS   : none
+// RETURNS      : int
+//
+int CountCitationsMissingData(void) {
+	int found = 0;
+	int rows = Store.Count;
+	for (int b = 0; b < Store.BlockCount && rows > 0; b++) {
+		StoreBlock* block = &Store.Blocks[b];
+		int count = rows < (STORE_SIZE << b) ? rows : (STORE_SIZE << b);
+		for (int i = 0; i < count; i++) {
+			if (block->Handles[i] != NULL && block->States[i] == CITATION_PENDING &&
+				(block->Authors[i][0] == '\0' || block->Titles[i][0] == '\0' || block->Years[i] == 0)) {
+				found++;
+			}
+		}
+		rows -= count;
+	}
+	return found;
+}
+
+//
+// FUNCTION     : CountStoreAllocations
+// DESCRIPTION  : Returns the number of times the store has allocated memory (growing its columns or adding a chunk to
+//                its string arena)
+// PARAMETERS   : none
+// RETURNS      : int
+//
+int CountStoreAllocations(void) {
+	std::lock_guard<std::mutex> guard(StoreLock);
+	return Store.Allocations;
+}
+
+//
+// FUNCTION     : FreeCitationStore
+// DESCRIPTION  : Frees every column, string and collation key of the store a chunk at a time - no citation may be
+//                used afterwards
+// PARAMETERS   : none
+// RETURNS      : void
+//
+void FreeCitationStore(void) {
+	FreeChunks(Store.Chunks);
+
+	// Every column of a block is in the allocation that starts with its handles
+	for (int b = 0; b < Store.BlockCount; b++) {
+		free(Store.Blocks[b].Handles);
+	}
+	free(Store.FreeRows);
+	memset(&Store, 0, sizeof(Store));
+}
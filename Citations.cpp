@@ -23,36 +23,105 @@
 
 //
 // FUNCTION     : InitializeCitation
-// DESCRIPTION  : Dynamically allocates memory for a Citation struct
+// DESCRIPTION  : Dynamically allocates memory for a Citation struct and gives it a row of the citation store
 // PARAMETERS   : const char* url : URL of website to be stored
 // RETURNS      : Citation*
 //
 Citation* InitializeCitation(const char* url) {
-    Citation* newCitation = (Citation*)malloc(sizeof(Citation));
+    return InitializeCitationWithURL(internURL(url));
+}
+
+//
+// FUNCTION     : InitializeCitationWithURL
+// DESCRIPTION  : Creates a citation like InitializeCitation for a canonical URL that is not interned in the URL pool.
+//                Used for citations that are written and freed straight away, so the URL pool does not keep growing
+// PARAMETERS   : const char* canonical : Canonical URL (see canonicalizeURL) - must stay valid until the citation
+//                                        is freed
+// RETURNS      : Citation*
+//
+Citation* InitializeCitationWithURL(const char* canonical) {
+    Citation* newCitation = (Citation*)AllocateNode(POOL_CITATION);
 
     if (newCitation == NULL) {
         printf("Insufficient memory to create citation. Exiting program...\n");
         exit(EXIT_FAILURE);
     }
 
-    // Initialize timestamp
-    time_t now = time(NULL);
-    char dateAccessed[TIMESTAMP];
-    strftime(dateAccessed, sizeof(dateAccessed), "%Y-%m-%d", localtime(&now));
-
-    // Initialize values for citation
-    newCitation->Author = _strdup("");
-    newCitation->Title = _strdup("");
-    newCitation->Year = 0;
-    newCitation->Next = NULL;
+    // Initialize values for citation (the store starts it with no author, title or year)
+    newCitation->CollationKey = NULL;
+    newCitation->CollationLength = 0;
+    newCitation->Position = -1;
+    newCitation->Sequence = 0;
 
-    // Store values in citation
-    newCitation->URL = _strdup(url);
-    strncpy(newCitation->DateAccessed, dateAccessed, TIMESTAMP);
+    // Store values in citation (dated with the access date of the current import, see SetAccessDate)
+    newCitation->Row = AllocateCitationRow(newCitation, canonical);
 
     return newCitation;
 }
 
+//
+// FUNCTION     : FreeCitation
+// DESCRIPTION  : Frees a citation node and its row of the citation store (including its collation key)
+// PARAMETERS   : Citation* citation : Citation to free
+// RETURNS      : void
+//
+void FreeCitation(Citation* citation) {
+	if (citation == NULL) {
+		return;
+	}
+	ReleaseCitationRow(citation);
+	FreeNode(POOL_CITATION, citation);
+}
+
+//
+// FUNCTION     : CollationKey
+// DESCRIPTION  : Returns the key a citation is sorted by, building it the first time it is needed. The key is the
+//				  first LINE_SIZE - 1 characters of the author, or the title if there is no author, or the URL without
+//				  its protocol if there is neither. Every byte is flipped by 0x80 so memcmp orders keys the same way
+//				  compareStrings orders the strings (signed characters), and the key ends with the flipped '\0' (0x80)
+//				  so a shorter key compares correctly against a longer one over length + 1 bytes. The key is kept in
+//				  the string arena of the citation store (see StoreCollationKey)
+// PARAMETERS   : Citation* citation : Citation to get the key of
+//				  int* length		 : Set to the length of the key, not counting the end marker
+// RETURNS      : const unsigned char*
+//
+const unsigned char* CollationKey(Citation* citation, int* length) {
+	if (citation->CollationKey == NULL) {
+		const char* source = NULL;
+		if (strlen(GetCitationAuthor(citation)) > 0) {
+			source = GetCitationAuthor(citation);
+		}
+		else if (strlen(GetCitationTitle(citation)) > 0) {
+			source = GetCitationTitle(citation);
+		}
+		else {
+			source = trimURL(GetCitationURL(citation));
+		}
+
+		unsigned char key[LINE_SIZE];
+		int sourceLength = (int)strnlen(source, LINE_SIZE - 1);
+		for (int i = 0; i < sourceLength; i++) {
+			key[i] = (unsigned char)source[i] ^ 0x80;
+		}
+		key[sourceLength] = 0x80;
+
+		StoreCollationKey(citation, key, sourceLength);
+	}
+
+	*length = citation->CollationLength;
+	return citation->CollationKey;
+}
+
+//
+// FUNCTION     : invalidateCollationKey
+// DESCRIPTION  : Discards the collation key of a citation - must be called whenever its author or title changes
+// PARAMETERS   : Citation* citation : Citation that was changed
+// RETURNS      : void
+//
+void invalidateCollationKey(Citation* citation) {
+	DropCollationKey(citation);
+}
+
 //
 // FUNCTION     : printCitation
 // DESCRIPTION  : Prints a citation struct data to the screen
@@ -67,48 +136,28 @@ void printCitation(Citation* citation) {
 	}
 
 	// Print citation to screen
-	printf("URL: %s\n", citation->URL);
-	if (strlen(citation->Title) > 0) {
-		printf("Author: %s\n", citation->Author);
+	printf("URL: %s\n", GetCitationURL(citation));
+	if (strlen(GetCitationTitle(citation)) > 0) {
+		printf("Author: %s\n", GetCitationAuthor(citation));
 	}
 	else {
 		printf("Author: [blank]\n");
 	}
-	if (strlen(citation->Title) > 0) {
-		printf("Title: %s\n", citation->Title);
+	if (strlen(GetCitationTitle(citation)) > 0) {
+		printf("Title: %s\n", GetCitationTitle(citation));
 	}
 	else {
 		printf("Title: [blank]\n");
 	}
-	if (citation->Year > 0) {
-		printf("Year: %d\n", citation->Year);
+	if (GetCitationYear(citation) > 0) {
+		printf("Year: %d\n", GetCitationYear(citation));
 	}
 	else {
 		printf("Year: [blank]\n");
 	}
-	printf("Date Accessed: %s\n", citation->DateAccessed);
-}
-
-//
-// FUNCTION     : printAllCitations
-// DESCRIPTION  : Prints all citations given a citation node
-// PARAMETERS   : Citation*	citation : Pointer to citation struct
-// RETURNS      : void
-//
-void printAllCitations(Citation* citation) {
-	// Iterate through all citations
-	Citation* current = citation;
-	Citation* next;
-
-	while (current != NULL) {
-		// Store next pointer
-		next = current->Next;
-		// Print citation
-		printCitation(current);
-		printf("---------------------------------------------\n");
-		// Move next pointer
-		current = next;
-	}
+	char date[TIMESTAMP];
+	formatDate(GetCitationDateAccessed(citation), date);
+	printf("Date Accessed: %s\n", date);
 }
 
 // User Menu Functions
@@ -153,12 +202,15 @@ void addCitation(CitationManager* Citations, Queue* CitationsToProcess) {
 	// If user cancels, stop adding citation and return
 	if (strlen(URL) == 0) {
 		printf("Cancelled adding citation.\n");
+		free(URL);
 		return;
 	}
 
-	// Create citation with data
+	// Create citation with data (the citation keeps its own copy of the URL)
+	SetAccessDate(currentDate());
 	Citation* newCitation = InitializeCitation(URL);
 	bool insertedSuccessfully = InsertHashTable(Citations, newCitation);
+	free(URL);
 
 	if (insertedSuccessfully) {
 		// Ask user to input other data
@@ -171,22 +223,29 @@ void addCitation(CitationManager* Citations, Queue* CitationsToProcess) {
 			return;
 		}
 
-		// Assign data to citation
+		// Assign data to citation (reindexing it under the new data)
+		UnindexCitation(&Citations->Indexes, newCitation);
 		if (strlen(author) > 0) {
-			newCitation->Author = _strdup(author);
+			SetCitationAuthor(newCitation, author);
 		}
 		if (strlen(title) > 0) {
-			newCitation->Title = _strdup(title);
+			SetCitationTitle(newCitation, title);
 		}
 		if (year != 0) {
-			newCitation->Year = year;
+			SetCitationYear(newCitation, year);
 		}
+		IndexCitation(&Citations->Indexes, newCitation);
+		free(author);
+		free(title);
 
 		// Add citation to hash table and queue
 		Enqueue(CitationsToProcess, newCitation);
 
 		printf("Citation added.\n");
 	}
+	else {
+		FreeCitation(newCitation);
+	}
 }
 
 //
@@ -211,11 +270,13 @@ void updateCitation(CitationManager* Citations) {
 	// If user cancels, stop adding citation and return
 	if (strlen(URL) == 0) {
 		printf("Cancelled updating citation.\n");
+		free(URL);
 		return;
 	}
 
 	// Look up Citation using hash table
 	Citation* citationToUpdate = SearchHashTable(Citations, URL);
+	free(URL);
 
 	if (citationToUpdate == NULL) {
 		printf("Citation for that URL not found.\n");
@@ -227,16 +288,20 @@ void updateCitation(CitationManager* Citations) {
 	title = inputTitle();
 	year = inputYear();
 
-	// Assign data to citation
+	// Assign data to citation (reindexing it under the new data)
+	UnindexCitation(&Citations->Indexes, citationToUpdate);
 	if (strlen(author) > 0) {
-		citationToUpdate->Author = _strdup(author);
+		SetCitationAuthor(citationToUpdate, author);
 	}
 	if (strlen(title) > 0) {
-		citationToUpdate->Title = _strdup(title);
+		SetCitationTitle(citationToUpdate, title);
 	}
 	if (year != 0) {
-		citationToUpdate->Year = year;
+		SetCitationYear(citationToUpdate, year);
 	}
+	IndexCitation(&Citations->Indexes, citationToUpdate);
+	free(author);
+	free(title);
 
 	printf("\nCitation updated:\n");
 	printCitation(citationToUpdate);
@@ -265,86 +330,137 @@ void removeCitation(CitationManager* Citations, Queue* CitationsToProcess, Stack
 	// If user cancels, stop adding citation and return
 	if (strlen(URL) == 0) {
 		printf("Cancelled removing citation.\n");
+		free(URL);
 		return;
 	}
 
 	// Delete Citation KVP from hash table
 	CitationKVP* citationToDelete = SearchKVPHashTable(Citations, URL);
+	free(URL);
 	if (citationToDelete == NULL) {
 		printf("Citation for that URL not found.\n");
 		return;
 	}
 
-	// Remove Citation from queue
-	Citation* toFree = NULL;
-	if (!isQueueEmpty(CitationsToProcess)) {
-		Citation* current = CitationsToProcess->Front;
-		// Check front of queue
-		if (strcmp(current->URL, URL) == 0) {
-			toFree = Dequeue(CitationsToProcess);
-		}
-		else {
-			while (current->Next != NULL) {
-				// If next node matches URL
-				if (strcmp(current->Next->URL, URL) == 0) {
-					// Change pointer to the back of queue if removing from the back
-					if (current->Next == CitationsToProcess->Back) {
-						CitationsToProcess->Back = current;
-					}
-					// Move current node's pointer to next node's next
-					current->Next = current->Next->Next;
-					break;
-				}
-				current = current->Next;
+	// Remove Citation from the queue or stack it is in, using its position
+	Citation* toFree = citationToDelete->Citation;
+	if (GetCitationState(toFree) == CITATION_PENDING) {
+		RemoveFromQueue(CitationsToProcess, toFree);
+	}
+	else if (GetCitationState(toFree) == CITATION_PROCESSED) {
+		RemoveFromStack(ProcessedCitations, toFree);
+	}
+
+	// Free citation node
+	DeleteHashTable(Citations, citationToDelete);
+	FreeCitation(toFree);
+
+	printf("Citation successfully deleted.\n");
+}
+
+//
+// FUNCTION		:	searchCitations
+// DESCRIPTION	:	Allows a user to find citations by author, title, website host or range of years using the
+//					secondary indexes
+// PARAMETERS	:	CitationManager* Citations	:	Hash table containing citations
+// RETURNS		:	void
+//
+void searchCitations(CitationManager* Citations) {
+	printf("\nSearch Citations:\n");
+	printf("--------------------\n");
+
+	int searchChoice = 0;
+	searchMenu();
+	getMenuNum(&searchChoice);
+
+	char input[LINE_SIZE] = "";
+	char* search = NULL;
+	int found = 0;
+
+	switch (searchChoice - 1) {
+		// User searches by words of the author or title
+		case SEARCH_AUTHOR:
+		case SEARCH_TITLE: {
+			printf("Enter words to search for: ");
+			fgets(input, sizeof(input), stdin);
+			clearNewLineChar(input);
+			search = trimWhitespace(input);
+
+			TermIndex* index = searchChoice - 1 == SEARCH_AUTHOR ? &Citations->Indexes.Authors : &Citations->Indexes.Titles;
+			Citation** results = NULL;
+			found = SearchWordIndex(&Citations->Indexes, index, search, &results);
+			for (int i = 0; i < found; i++) {
+				printCitation(results[i]);
+				printf("---------------------------------------------\n");
 			}
-			toFree = citationToDelete->Citation;
+			free(results);
+			break;
 		}
-	}
 
-	// Remove Citation from stack
-	Citation* toFree2 = NULL;
-	if (!isStackEmpty(ProcessedCitations)) {
-		Citation* current2 = ProcessedCitations->Top;
-		// Check top of stack
-		if (strcmp(current2->URL, URL) == 0) {
-			toFree2 = Pop(ProcessedCitations);
+		// User searches by website host
+		case SEARCH_HOST: {
+			printf("Enter website host (e.g. example.com): ");
+			fgets(input, sizeof(input), stdin);
+			clearNewLineChar(input);
+			search = trimWhitespace(input);
+
+			Postings* list = SearchHostIndex(&Citations->Indexes, search);
+			for (int i = 0; list != NULL && i < list->Count; i++) {
+				printCitation(list->Items[i]);
+				printf("---------------------------------------------\n");
+				found++;
+			}
+			break;
 		}
-		else {
-			while (current2->Next != NULL) {
-				// If next node matches URL
-				if (strcmp(current2->Next->URL, URL) == 0) {
-					// Move current node's pointer to next node's next
-					current2->Next = current2->Next->Next;
-					ProcessedCitations->StackIndex--; // Decrement stack index
-					break;
+
+		// User searches by range of years (a blank year leaves that end of the range open)
+		case SEARCH_YEAR: {
+			printf("First year of range:\n");
+			int from = inputYear();
+			printf("Last year of range:\n");
+			int to = inputYear();
+			if (from == 0) {
+				from = 1;
+			}
+			if (to == 0) {
+				to = 9999;
+			}
+
+			YearEntry* first = NULL;
+			int years = SearchYearIndex(&Citations->Indexes, from, to, &first);
+			for (int y = 0; y < years; y++) {
+				for (int i = 0; i < first[y].List.Count; i++) {
+					printCitation(first[y].List.Items[i]);
+					printf("---------------------------------------------\n");
+					found++;
 				}
-				current2 = current2->Next;
 			}
-			toFree2 = citationToDelete->Citation;
+			break;
 		}
-	}
 
-	// Free citation node
-	DeleteHashTable(Citations, citationToDelete);
-	if (toFree != NULL) {
-		free(toFree);
-	}
-	if (toFree2 != NULL) {
-		free(toFree2);
+		// User chooses to cancel - return to main menu
+		case SEARCH_CANCEL:
+			printf("Cancelled searching citations.\n");
+			return;
+
+		// User selects invalid choice
+		default:
+			printf("Error: Invalid option. Please select an option from the menu.\n");
+			return;
 	}
 
-	printf("Citation successfully deleted.\n");
+	printf("%d citation(s) found.\n", found);
 }
 
 //
 // FUNCTION		:	processCitations
 // DESCRIPTION	:	Moves citations from queue to sorted linked list and/or stack
-// PARAMETERS	:	Citation* Head				: Pointer to head of sorted linked list
+// PARAMETERS	:	CitationManager* Citations	: Hash table containing citations
 //					Queue* CitationsToProcess	: Queue to store citations that need to be processed
 //					Stack* ProcessedCitations	: Stack of citations that have been processed
 // RETURNS		:	void
 //
-void processCitations(Citation* Head, Queue* CitationsToProcess, Stack* ProcessedCitations) {
+void processCitations(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations) {
 	// If there are no citations to process, return
 	if (isQueueEmpty(CitationsToProcess)) {
 		printf("No citations stored to process.\n");
@@ -364,17 +480,17 @@ void processCitations(Citation* Head, Queue* CitationsToProcess, Stack* Processe
 		switch (processChoice - 1) {
 			// User selects to update all citations
 			case UPDATE_ALL:
-				updateAllCitations(CitationsToProcess);
+				updateAllCitations(Citations, CitationsToProcess);
 				break;
 
 			// User selects to sort all of the current citations and sort them
 			case SORT_ALL:
-				sortAllCitations(Head, CitationsToProcess);
+				sortAllCitations(Citations, CitationsToProcess);
 				break;
 
 			// User selects to webscrape of the current citations and sort them
 			case WEB_SCRAPE_ALL:
-				webscrapeAllCitations(CitationsToProcess);
+				webscrapeAllCitations(Citations, CitationsToProcess);
 				break;
 
 			// User selects to process all citations - break loop
@@ -400,64 +516,70 @@ void processCitations(Citation* Head, Queue* CitationsToProcess, Stack* Processe
 //
 // FUNCTION		:	updateAllCitations
 // DESCRIPTION	:	Iterates through entire queue and prompts user to update each citation
-// PARAMETERS	:	Queue* CitationsToProcess	: Queue to store citations that need to be processed
+// PARAMETERS	:	CitationManager* Citations	: Hash table containing citations
+//					Queue* CitationsToProcess	: Queue to store citations that need to be processed
 // RETURNS		:	void
 //
-void updateAllCitations(Queue* CitationsToProcess) {
+void updateAllCitations(CitationManager* Citations, Queue* CitationsToProcess) {
 	// Check if queue of citations is empty
 	if (isQueueEmpty(CitationsToProcess)) {
 		return;
 	}
 
-	// Iterate through queue
-	Citation* current = CitationsToProcess->Front;
-	Citation* next;
-
 	int year = 0;
+	printf("\n%d citation(s) are missing an author, title or year.\n", CountCitationsMissingData());
+
+	// Iterate through queue and add/update citation data
+	for (int i = 0; i < CitationsToProcess->Count; i++) {
+		Citation* current = QueueAt(CitationsToProcess, i);
+		if (current == NULL) {
+			continue; // Removed citation
+		}
 
-	// Add/update citation data
-	while (current != NULL) {
 		printf("\nAdd Citation Data:\n");
 		printf("--------------------\n");
-		printf("URL: %s\n", current->URL);
+		printf("URL: %s\n", GetCitationURL(current));
+		UnindexCitation(&Citations->Indexes, current);
 		
-		if (strlen(current->Author) == 0) {
+		if (strlen(GetCitationAuthor(current)) == 0) {
 			char* author = inputAuthor();
 			if (strlen(author) > 0) {
-				current->Author = _strdup(author);
-				printf("Author: %s\n", current->Author);
+				SetCitationAuthor(current, author);
+				printf("Author: %s\n", GetCitationAuthor(current));
 			}
+			free(author);
 		}
 		else {
-			printf("Author: %s\n", current->Author);
+			printf("Author: %s\n", GetCitationAuthor(current));
 		}
 
-		if (strlen(current->Title) == 0) {
+		if (strlen(GetCitationTitle(current)) == 0) {
 			char* title = inputTitle();
-			current->Title = _strdup(title);
-			printf("Title: %s\n", current->Title);
+			SetCitationTitle(current, title);
+			printf("Title: %s\n", GetCitationTitle(current));
+			free(title);
 		}
 		else {
-			printf("Title: %s\n", current->Title);
+			printf("Title: %s\n", GetCitationTitle(current));
 		}
 
 		if (year == 0) {
 			year = inputYear();
 			if (year > 0) {
-				printf("Year: %d\n", current->Year);
-				current->Year = year;
+				printf("Year: %d\n", GetCitationYear(current));
+				SetCitationYear(current, year);
 			}
 		}
 		else {
-			printf("Year: %d\n", current->Year);
+			printf("Year: %d\n", GetCitationYear(current));
 		}
 
-		printf("Date Accessed: %s", current->DateAccessed);
+		char date[TIMESTAMP];
+		formatDate(GetCitationDateAccessed(current), date);
+		printf("Date Accessed: %s", date);
+		IndexCitation(&Citations->Indexes, current);
 
 		printf("\n\nAll citation data added.\n\n");
-
-		// Move pointer
-		current = current->Next;
 	}
 
 }
@@ -465,11 +587,11 @@ void updateAllCitations(Queue* CitationsToProcess) {
 //
 // FUNCTION		:	sortAllCitations
 // DESCRIPTION	:	Calls SortQueue to sort the citations in a queue
-// PARAMETERS	:	Citation* Head				: Pointer to head of sorted linked list
+// PARAMETERS	:	CitationManager* Citations	: Hash table containing citations
 //					Queue* CitationsToProcess	: Queue to store citations that need to be processed
 // RETURNS		:	void
 //
-void sortAllCitations(Citation* Head, Queue* CitationsToProcess) {
+void sortAllCitations(CitationManager* Citations, Queue* CitationsToProcess) {
 	// Check if queue of citations is empty
 	if (isQueueEmpty(CitationsToProcess)) {
 		return;
@@ -479,33 +601,39 @@ void sortAllCitations(Citation* Head, Queue* CitationsToProcess) {
 	printf("--------------------\n");
 
 	// Call SortQueue to sort the queue
-	SortQueue(Head, CitationsToProcess);
+	SortQueue(Citations, CitationsToProcess);
 
-	printAllCitations(CitationsToProcess->Front);
+	printQueue(CitationsToProcess);
 }
 
 //
 // FUNCTION		:	webscrapeAllCitations
 // DESCRIPTION	:	Attempts web scraping to add citation data
-// PARAMETERS	:	Queue* CitationsToProcess	: Queue to store citations that need to be processed
+// PARAMETERS	:	CitationManager* Citations	: Hash table containing citations
+//					Queue* CitationsToProcess	: Queue to store citations that need to be processed
 // RETURNS		:	void
 //
-void webscrapeAllCitations(Queue* CitationsToProcess) {
+void webscrapeAllCitations(CitationManager* Citations, Queue* CitationsToProcess) {
 	// Check if queue of citations is empty
 	if (isQueueEmpty(CitationsToProcess)) {
 		return;
 	}
 
 	printf("\nScraping the web for data...\n\n");
-	Citation* current = CitationsToProcess->Front;
-	while (current != NULL) {
-		// Call WebScraping
+	for (int i = 0; i < CitationsToProcess->Count; i++) {
+		Citation* current = QueueAt(CitationsToProcess, i);
+		if (current == NULL) {
+			continue; // Removed citation
+		}
+
+		// Call WebScraping (reindexing the citation under the scraped data)
+		UnindexCitation(&Citations->Indexes, current);
 		WebScraping(current);
+		IndexCitation(&Citations->Indexes, current);
 
 		// Print each citation
 		printCitation(current);
 		printf("\n");
-		current = current->Next;
 	}
 
 	printf("\nWeb scraping complete.\n");
@@ -524,22 +652,14 @@ void processAllCitations(Queue* CitationsToProcess, Stack* ProcessedCitations) {
 		return;
 	}
 
-	// Move all items in queue to stack
-	Citation* current = CitationsToProcess->Front;
-	Citation* next;
-
+	// Move all items in queue to stack by dequeuing
 	printf("\nProcessed Citations:\n\n");
-	while (current != NULL) {
-		// Store next pointer in queue
-		next = current->Next;
-
-		// Push current citation to the stack by dequeuing
+	while (!isQueueEmpty(CitationsToProcess)) {
 		Push(ProcessedCitations, Dequeue(CitationsToProcess));
-		current = next;
 	}
 
 	// Print all processed citations
-	printAllCitations(ProcessedCitations->Top);
+	printStack(ProcessedCitations);
 
 }
 
@@ -6,46 +6,246 @@
 #include <string.h>
 #include <time.h>
 #include <regex>
+#include <mutex>
 
 // Define constants
 #define	LINE_SIZE	256
-#define HASH_TABLE_SIZE	100
+#define HASH_TABLE_SIZE	128	// Initial number of slots (must be a power of 2)
+#define HASH_MAX_LOAD	75	// Grow hash table once it is this % full
+#define REHASH_STEP	8	// Number of old groups migrated per hash table operation
+#define HASH_SHARDS	16	// Number of independently locked shards of the hash table (must be a power of 2)
+#define ORDER_MAX_LEVEL	32	// Maximum number of levels of the ordered index
+#define ORDER_POOL_LEVELS	4	// Ordered index nodes with up to this many levels are allocated from a node pool
+
+// Define number of control bytes compared at once by the hash table
+#if defined(__AVX2__)
+#define HASH_GROUP_WIDTH	32
+#else
+#define HASH_GROUP_WIDTH	16
+#endif
 #define TIMESTAMP	11
-#define BIB_SIZE	865
+#define READ_BLOCK_SIZE	(1 << 20)	// Bytes read from an import file at a time
+#define WRITE_BLOCK_SIZE	(1 << 20)	// Bytes collected before they are written to an export file
+
+// Define Packed Date
+// Calendar date packed into one integer as (year << 9) | (month << 5) | day, so later dates compare greater
+typedef unsigned int PackedDate;
+
+// Define Citation Lifecycle
+enum CitationState {
+	CITATION_PENDING, // Waiting in the queue of citations to process
+	CITATION_PROCESSED, // In the stack of processed citations
+	CITATION_EXPORTED // Written to a .bib file
+};
 
 // Define Citation Node
+// Handle to a row of the citation store, which holds the URL, author, title, year, date accessed and state of every
+// citation in columns. Those fields are read and changed with the GetCitation... and SetCitation... functions
 typedef struct Citation {
-	char* Author;
-	char* Title;
-	int Year;
-	char* URL;
-	char DateAccessed[TIMESTAMP];
-	struct Citation* Next;
+	int Row; // Row of the citation's fields in the citation store
+	unsigned char* CollationKey; // Sort key built from the author, title or URL, in the store's string arena (or NULL)
+	int CollationLength; // Length of CollationKey, not counting its end marker
+	int Position; // Slot of the citation in the queue or stack it is in (-1 if it is in neither)
+	unsigned long long Sequence; // Order the citation was first indexed in (0 until then), breaks ties in sort order
 } Citation;
 
+// Define Hash Function
+// Any function that hashes a string of a given length to 64 bits can be used by the hash table
+typedef unsigned long long (*HashFunction)(const char* str, size_t length);
+
 // Define Key-Value Pair to store citations
 typedef struct CitationKVP {
-	char* URL;
+	const char* URL; // Key: the citation URL without its scheme (points into the citation's interned URL)
 	Citation* Citation;
-	struct CitationKVP* NextKeyValuePair;
+	unsigned long long Hash; // Full hash of URL, kept so the KVP can be found again without rehashing
 
 } CitationKVP;
 
+// Define Node Pools
+// Fixed-size nodes are allocated from slabs by AllocateNode and recycled by FreeNode
+enum NodePoolType {
+	POOL_CITATION, // Citation nodes
+	POOL_KVP, // Hash table key-value pairs
+	POOL_ORDER, // Ordered index nodes with up to ORDER_POOL_LEVELS levels
+	POOL_COUNT
+};
+
+// Define Line View
+// One line of a file read by a line reader, without its line ending. The text stays in the reader's buffer (null
+// terminated in place) and is only valid until the next line is read
+typedef struct LineView {
+	char* Text;
+	size_t Length;
+} LineView;
+
+// Define BibLaTeX Writer
+// Collects citations formatted as BibLaTeX entries in a buffer and writes the buffer to the file in blocks of about
+// WRITE_BLOCK_SIZE bytes. A field longer than the buffer grows it, so entries of any length are written in full
+typedef struct BibWriter {
+	FILE* File;
+	char* Buffer;
+	size_t Length; // Bytes waiting in Buffer
+	size_t Capacity; // Size of Buffer
+	bool Error; // A write to the file failed
+} BibWriter;
+
+// Define Line Reader
+// Reads a file in blocks of up to READ_BLOCK_SIZE bytes and splits them into lines of any length without copying them.
+// A pipe or console only needs to fill part of a block, so lines are handed out as soon as they arrive
+typedef struct LineReader {
+	FILE* File;
+	char* Buffer;
+	size_t Capacity; // Size of Buffer (a line longer than a block grows it)
+	size_t Start; // Start of the next line in Buffer
+	size_t End; // End of the data read into Buffer
+	size_t Scanned; // Bytes after Start already searched for a newline
+	BibWriter* Flush; // Writer flushed before the reader waits for more of the file (NULL for none)
+	bool EndOfFile;
+	bool Error;
+} LineReader;
+
+// Define URL List
+// The different valid URLs of a file, read by ReadURLList for the hash report and benchmarks. URLs are canonicalized
+// and stored one after another in a single buffer, in the order they were first read
+typedef struct URLList {
+	char* Text; // Canonical URLs, each null-terminated
+	size_t Length; // Bytes used in Text
+	size_t TextCapacity; // Size of Text
+	size_t* URLs; // Start of each canonical URL in Text
+	size_t* Keys; // Start of each URL's key in Text (see URLKey)
+	size_t* KeyLengths; // Length of each key
+	int Count; // Number of different URLs
+	int Capacity; // Size of URLs, Keys and KeyLengths
+	int Read; // Number of valid URLs read, counting repeated URLs
+} URLList;
+
+// Define Hash Table Slot
+// Each slot caches the full hash next to the KVP so a string compare is only needed when the hashes match
+typedef struct HashSlot {
+	unsigned long long Hash;
+	CitationKVP* KVP;
+} HashSlot;
+
+// Define Open-Addressing Index
+// Control holds one byte per slot: CTRL_EMPTY, CTRL_DELETED or the low 7 bits of the hash of a full slot.
+// Slots are probed a group (HASH_GROUP_WIDTH control bytes) at a time using SSE2/AVX2 compares
+typedef struct HashIndex {
+	unsigned char* Control;
+	HashSlot* Slots;
+	unsigned int Capacity;
+	unsigned int Count;
+	unsigned int Tombstones;
+} HashIndex;
+
+// Define Hash Table Shard
+// The index is rebuilt once the load factor passes HASH_MAX_LOAD. Groups are moved to the new index a few at a time
+// (REHASH_STEP) on each insert, so no single insert has to rehash the whole library.
+typedef struct HashShard {
+	HashIndex Current;
+	HashIndex Old; // Index being migrated (Control is NULL if no resize is in progress)
+	unsigned int MigrateIndex; // Next group of Old to migrate
+	std::mutex* Lock; // Held for every search, insert and delete in this shard
+} HashShard;
+
+// Define Postings List
+// Citations indexed under one year, host or word, in no particular order. Once a list is long, Slots maps each
+// citation to its position in Items (open addressing), so a citation is found and swapped out in O(1)
+typedef struct Postings {
+	Citation** Items;
+	int Count;
+	int Capacity;
+	int* Slots; // Positions in Items, or -1 for an empty slot (NULL while the list is short)
+	int SlotCapacity; // Size of Slots (a power of 2, at least twice Capacity)
+} Postings;
+
+// Define Term Index Entry
+typedef struct TermEntry {
+	char* Term; // Normalized word or host (NULL if the slot is empty)
+	unsigned long long Hash;
+	Postings List;
+} TermEntry;
+
+// Define Term Index
+// Maps a word or host to its postings list using linear probing. Terms are never removed, only their postings
+typedef struct TermIndex {
+	TermEntry* Entries;
+	unsigned int Capacity;
+	unsigned int Count;
+} TermIndex;
+
+// Define Year Index Entry
+typedef struct YearEntry {
+	int Year;
+	Postings List;
+} YearEntry;
+
+// Define Year Index
+// Entries are kept sorted by year, so a range of years is a contiguous run of entries
+typedef struct YearIndex {
+	YearEntry* Entries;
+	int Count;
+	int Capacity;
+} YearIndex;
+
+// Define Ordered Index Node
+typedef struct OrderNode {
+	Citation* Citation;
+	int Level; // Number of Next pointers
+	struct OrderNode* Next[1]; // Next node at each level (allocated with Level entries)
+} OrderNode;
+
+// Define Ordered Index
+// Skip list of citations in sort order: reverse-alphabetically by collation key, then by Sequence, which is the order
+// SortQueue puts them in. Walking Head->Next[0] visits every citation in that order
+typedef struct OrderedIndex {
+	OrderNode* Head; // Sentinel with ORDER_MAX_LEVEL levels
+	int Level; // Highest level in use
+	int Count;
+	unsigned long long Random; // State of the random number generator for node levels
+} OrderedIndex;
+
+// Define Secondary Indexes
+// Every citation in the hash table is indexed by year, by the host of its URL, by the words of its author and title,
+// and in sort order
+typedef struct CitationIndexes {
+	YearIndex Years;
+	TermIndex Hosts;
+	TermIndex Authors;
+	TermIndex Titles;
+	OrderedIndex Order;
+	unsigned long long NextSequence; // Sequence given to the next citation indexed for the first time
+	std::mutex* Lock; // Held while any index is read or changed
+} CitationIndexes;
+
 // Define Hash Table
+// URLs are spread over HASH_SHARDS shards by the top bits of their hash. Each shard has its own lock, so threads
+// working on different shards never wait for each other, and the search and insert for a duplicate check happen
+// under one lock
 typedef struct CitationManager {
-	CitationKVP* Table[HASH_TABLE_SIZE];
+	HashShard Shards[HASH_SHARDS];
+	HashFunction HashURL; // Hash function used for URLs
+	CitationIndexes Indexes; // Secondary indexes of every citation in the hash table
 } CitationManager;
 
 // Define Queue
+// Ring buffer of citations: the front is at Items[Front] and the rest follow, wrapping around the end of Items.
+// A citation removed from the middle leaves a NULL slot (tombstone) so no other citation has to move; the front and
+// back slots are never tombstones
 typedef struct Queue {
-	Citation* Front;
-	Citation* Back;
+	Citation** Items;
+	int Capacity; // Size of Items (always a power of 2)
+	int Front;
+	int Count; // Slots in use from the front, including tombstones
+	int Removed; // Tombstones among the slots in use
 } Queue;
 
 // Define Stack
+// Array of citations with the top at Items[Count - 1]. Removed citations leave tombstones like in the queue
 typedef struct Stack {
-	Citation* Top;
-	int StackIndex;
+	Citation** Items;
+	int Capacity;
+	int Count; // Slots in use, including tombstones
+	int Removed; // Tombstones among the slots in use
 } Stack;
 
 // Process operations
@@ -57,46 +257,142 @@ enum processing {
 	CANCEL
 };
 
+// Search operations
+enum searching {
+	SEARCH_AUTHOR,
+	SEARCH_TITLE,
+	SEARCH_HOST,
+	SEARCH_YEAR,
+	SEARCH_CANCEL
+};
+
 // Function Prototypes
 
 // File Functions
 FILE* LoadFile(void);
 void StoreFileData(FILE* file, CitationManager* Citations, Queue* CitationsToProcess);
-void InsertData(CitationManager* Citations, Queue* CitationsToProcess, const char* url);
+bool InsertData(CitationManager* Citations, Queue* CitationsToProcess, const char* url, size_t length);
+bool InsertCanonicalData(CitationManager* Citations, Queue* CitationsToProcess, const char* canonical, unsigned long long hash);
+bool ImportURLFile(FILE* file, CitationManager* Citations, Queue* CitationsToProcess);
+bool isBibFile(FILE* file);
+bool StoreBibData(FILE* file, CitationManager* Citations, Queue* CitationsToProcess);
+void streamCitations(FILE* ImportFile, FILE* ExportFile, bool webScrape);
+void ReadURLList(FILE* file, URLList* list);
+void FreeURLList(URLList* list);
+void SetImportThreads(int threads);
 void SaveFile(FILE* file, CitationManager* Citations, Stack* ProcessedCitations);
+void InitializeBibWriter(BibWriter* writer, FILE* file);
+void writeCitation(BibWriter* writer, Citation* citation, int index);
+bool FlushBibWriter(BibWriter* writer);
+bool FreeBibWriter(BibWriter* writer);
+FILE* openExportFile(const char* filename);
+void closeExportFile(FILE* file);
+
+// Decompression Functions
+FILE* openImportStream(FILE* file);
+int closeImportStream(FILE* file);
+
+// Line Reader Functions
+void InitializeLineReader(LineReader* reader, FILE* file);
+bool ReadLine(LineReader* reader, LineView* line);
+void trimLine(LineView* line);
+void FreeLineReader(LineReader* reader);
 
 // Citation Struct
 Citation* InitializeCitation(const char* url);
+Citation* InitializeCitationWithURL(const char* canonical);
+void FreeCitation(Citation* citation);
+const unsigned char* CollationKey(Citation* citation, int* length);
+void invalidateCollationKey(Citation* citation);
 void printCitation(Citation* citation);
-void printAllCitations(Citation* citation);
+
+// Citation Store Functions
+int AllocateCitationRow(Citation* citation, const char* url);
+void ReleaseCitationRow(Citation* citation);
+const char* GetCitationURL(Citation* citation);
+const char* GetCitationAuthor(Citation* citation);
+void SetCitationAuthor(Citation* citation, const char* author);
+const char* GetCitationTitle(Citation* citation);
+void SetCitationTitle(Citation* citation, const char* title);
+int GetCitationYear(Citation* citation);
+void SetCitationYear(Citation* citation, int year);
+PackedDate GetCitationDateAccessed(Citation* citation);
+void SetCitationDateAccessed(Citation* citation, PackedDate date);
+void SetAccessDate(PackedDate date);
+CitationState GetCitationState(Citation* citation);
+void SetCitationState(Citation* citation, CitationState state);
+int CountCitationsMissingData(void);
+void StoreCollationKey(Citation* citation, const unsigned char* key, int length);
+void DropCollationKey(Citation* citation);
+int CountStoreAllocations(void);
+void FreeCitationStore(void);
+
+// Node Pool Functions
+void* AllocateNode(NodePoolType type);
+void FreeNode(NodePoolType type, void* node);
+int CountNodeSlabs(NodePoolType type);
+void FreeNodePools(void);
 
 // Hash Table Functions
-unsigned int Hash(const char* str);
+unsigned long long HashDJB2(const char* str, size_t length);
+unsigned long long HashFast(const char* str, size_t length);
+void hashReport(const char* filename);
+void benchmarkReport(const char* filename);
 CitationManager* InitializeHashTable(void);
-CitationKVP* InitializeKeyValuePair(Citation* newCitation);
+void SetHashFunction(CitationManager* Citations, HashFunction hashFunction);
+void InitializeHashIndex(HashIndex* index, unsigned int capacity);
+void ResizeHashTable(HashShard* shard);
+void MigrateGroups(HashShard* shard, unsigned int steps);
+CitationKVP* InitializeKeyValuePair(Citation* newCitation, unsigned long long hash);
 bool InsertHashTable(CitationManager* Citations, Citation* newCitation);
+bool InsertHashTableWithHash(CitationManager* Citations, Citation* newCitation, unsigned long long hash);
 Citation* SearchHashTable(CitationManager* Citations, const char* url);
 CitationKVP* SearchKVPHashTable(CitationManager* Citations, const char* url);
+unsigned long long HashKey(CitationManager* Citations, const char* key);
+CitationKVP* SearchKeyHashTable(CitationManager* Citations, const char* key, unsigned long long hash);
 bool DeleteHashTable(CitationManager* Citations, CitationKVP* toDelete);
 void FreeHashTable(CitationManager* Citations); 
 
+// URL Pool Functions
+size_t canonicalizeURL(const char* url, size_t length, char* out);
+const char* URLKey(const char* url);
+const char* internURL(const char* url);
+int CountURLPoolAllocations(void);
+void FreeURLPool(void);
+
+// Secondary Index Functions
+void InitializeIndexes(CitationIndexes* indexes);
+void IndexCitation(CitationIndexes* indexes, Citation* citation);
+void UnindexCitation(CitationIndexes* indexes, Citation* citation);
+const char* URLHost(const char* url, size_t* length);
+int SearchWordIndex(CitationIndexes* indexes, TermIndex* index, const char* words, Citation*** results);
+Postings* SearchHostIndex(CitationIndexes* indexes, const char* host);
+int SearchYearIndex(CitationIndexes* indexes, int from, int to, YearEntry** first);
+OrderNode* FirstOrdered(CitationIndexes* indexes);
+int OrderedCount(CitationIndexes* indexes);
+void FreeIndexes(CitationIndexes* indexes);
+
 // Queue Functions
 struct Queue* InitializeQueue();
 bool isQueueEmpty(Queue* CitationsToProcess);
+Citation* QueueAt(Queue* CitationsToProcess, int position);
 void Enqueue(Queue* CitationsToProcess, Citation* newCitation);
 Citation* Dequeue(Queue* CitationsToProcess);
+bool RemoveFromQueue(Queue* CitationsToProcess, Citation* citation);
+void printQueue(Queue* CitationsToProcess);
 void FreeQueue(Queue* CitationsToProcess);
 
-// Sorted Linked List
-void InsertSorted(Citation** Head, Citation* newCitation);
-void SortQueue(Citation* Head, Queue* CitationsToProcess);
-void FreeSortedLinkedList(Citation* Head);
+// Sorting
+void SortQueue(CitationManager* Citations, Queue* CitationsToProcess);
+void SetSortThreads(int threads);
 
 // Stack Function Prototypes
 Stack* InitializeStack();
 bool isStackEmpty(Stack* ProcessedCitations);
 void Push(Stack* stack, Citation* completedCitation);
 Citation* Pop(Stack* stack);
+bool RemoveFromStack(Stack* ProcessedCitations, Citation* citation);
+void printStack(Stack* ProcessedCitations);
 void FreeStack(Stack* stack);
 
 // Main Program Functions
@@ -105,24 +401,27 @@ void addCitation(CitationManager* Citations, Queue* CitationsToProcess);
 void updateCitation(CitationManager* Citations);
 void removeCitation(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations);
 
-void processCitations(Citation* Head, Queue* CitationsToProcess, Stack* ProcessedCitations);
+void searchCitations(CitationManager* Citations);
+
+void processCitations(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations);
 void processAllCitations(Queue* CitationsToProcess, Stack* ProcessedCitations);
-void updateAllCitations(Queue* CitationsToProcess);
-void sortAllCitations(Citation* Head, Queue* CitationsToProcess);
-void webscrapeAllCitations(Queue* CitationsToProcess);
+void updateAllCitations(CitationManager* Citations, Queue* CitationsToProcess);
+void sortAllCitations(CitationManager* Citations, Queue* CitationsToProcess);
+void webscrapeAllCitations(CitationManager* Citations, Queue* CitationsToProcess);
 void exportCitations(FILE* ExportFile, CitationManager* Citations, Stack* ProcessedCitations);
 
-void freeMemory(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations, Citation* Head);
-void exitProgram(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations, Citation* Head);
+void freeMemory(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations);
+void exitProgram(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations);
 
 // Command Line Functions
-void importCitationsFile(FILE* ImportFile, Queue* CitationsToProcess, const char* filename);
+void importCitationsFile(FILE* ImportFile, CitationManager* Citations, Queue* CitationsToProcess, const char* filename);
 void exportCitationsFile(FILE* ExportFile, Queue* CitationsToProcess, const char* filename);
 
 // Menu Functions
 void header(void);
 void menu(void);
 void processMenu(void);
+void searchMenu(void);
 void getMenuNum(int* menuNum);
 void pressEntertoContinue(void);
 
@@ -136,5 +435,11 @@ int inputYear(void);
 bool compareStrings(char* str1, char* str2);
 void nullTerminate(char* str);
 void clearNewLineChar(char* str);
-char* trimURL(char* str);
-char* trimWhitespace(char* str);
\ No newline at end of file
+const char* trimURL(const char* str);
+char* trimWhitespace(char* str);
+bool isValidURL(const char* url, size_t length);
+
+// Dates
+PackedDate currentDate(void);
+void formatDate(PackedDate date, char* buffer);
+PackedDate parseDate(const char* text);
\ No newline at end of file
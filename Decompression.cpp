@@ -0,0 +1,333 @@
+/*
+* FILE          : Decompression.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the decompression of imported files. A file compressed with gzip or zstd is found
+*                 by its first bytes and decompressed on its own thread into a pipe, and the import reads the other end
+*                 of the pipe like a plain file. The import runs while the next block is decompressed, and nothing is
+*                 written to disk
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <thread>
+
+#include <zlib.h>
+#include <zstd.h>
+
+#include "Citations.h"
+
+// Define formats of imported files
+enum InputFormat {
+	INPUT_PLAIN, // Not compressed
+	INPUT_GZIP, // Starts with 1F 8B
+	INPUT_ZSTD // Starts with 28 B5 2F FD
+};
+
+// Define decompression thread of an imported file
+typedef struct DecompressStream {
+	FILE* Output; // Read end of the pipe, read by the import
+	FILE* Input; // File being decompressed
+	int Pipe; // Write end of the pipe
+	InputFormat Format;
+	unsigned char Magic[4]; // First bytes of the file, read to find its format
+	size_t MagicLength;
+	std::thread Thread;
+	DecompressStream* Next;
+} DecompressStream;
+
+// Files that are being decompressed (opened with openImportStream and not closed yet)
+static DecompressStream* gDecompressStreams = NULL;
+
+//
+// FUNCTION     : ReadInput
+// DESCRIPTION  : Reads the next compressed bytes of a file, starting with the bytes that were read to find its format
+// PARAMETERS   : DecompressStream* stream : File being decompressed
+//                unsigned char* buffer    : Stores the bytes read
+//                size_t capacity          : Size of buffer
+// RETURNS      : int                      : Number of bytes read, 0 at the end of the file, or -1 on a read error
+//
+static int ReadInput(DecompressStream* stream, unsigned char* buffer, size_t capacity) {
+	if (stream->MagicLength > 0) {
+		size_t length = stream->MagicLength;
+		memcpy(buffer, stream->Magic, length);
+		stream->MagicLength = 0;
+		return (int)length;
+	}
+	return _read(_fileno(stream->Input), buffer, (unsigned int)capacity);
+}
+
+//
+// FUNCTION     : WriteOutput
+// DESCRIPTION  : Writes decompressed bytes to the pipe, waiting while the import catches up
+// PARAMETERS   : DecompressStream* stream : File being decompressed
+//                const unsigned char* data : Bytes to write
+//                size_t length             : Number of bytes
+// RETURNS      : bool                      : false if the import closed its end of the pipe
+//
+static bool WriteOutput(DecompressStream* stream, const unsigned char* data, size_t length) {
+	while (length > 0) {
+		int written = _write(stream->Pipe, data, (unsigned int)length);
+		if (written <= 0) {
+			return false;
+		}
+		data += written;
+		length -= written;
+	}
+	return true;
+}
+
+//
+// FUNCTION     : InflateGzip
+// DESCRIPTION  : Decompresses a gzip file into the pipe. Files made of several gzip members (such as files joined
+//                with cat) are decompressed one member after another
+// PARAMETERS   : DecompressStream* stream : File being decompressed
+//                unsigned char* in        : Buffer for compressed bytes
+//                unsigned char* out       : Buffer for decompressed bytes
+//                size_t size              : Size of each buffer
+// RETURNS      : void
+//
+static void InflateGzip(DecompressStream* stream, unsigned char* in, unsigned char* out, size_t size) {
+	z_stream zip;
+	memset(&zip, 0, sizeof(zip));
+	if (inflateInit2(&zip, 15 + 16) != Z_OK) {
+		fprintf(stderr, "Insufficient memory to decompress file.\n");
+		return;
+	}
+
+	bool ended = false; // The last member was decompressed to its end
+	while (true) {
+		if (zip.avail_in == 0) {
+			int bytes = ReadInput(stream, in, size);
+			if (bytes <= 0) {
+				if (bytes < 0) {
+					fprintf(stderr, "Error reading file.\n");
+				}
+				else if (!ended) {
+					fprintf(stderr, "Error decompressing file: the gzip data ends early.\n");
+				}
+				break;
+			}
+			zip.next_in = in;
+			zip.avail_in = (uInt)bytes;
+		}
+
+		// Another member follows the one that ended
+		if (ended) {
+			inflateReset(&zip);
+			ended = false;
+		}
+
+		zip.next_out = out;
+		zip.avail_out = (uInt)size;
+		int status = inflate(&zip, Z_NO_FLUSH);
+		if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+			fprintf(stderr, "Error decompressing file: %s.\n", zip.msg != NULL ? zip.msg : "the gzip data is not valid");
+			break;
+		}
+		if (!WriteOutput(stream, out, size - zip.avail_out)) {
+			break;
+		}
+		ended = status == Z_STREAM_END;
+	}
+
+	inflateEnd(&zip);
+}
+
+//
+// FUNCTION     : DecompressZstd
+// DESCRIPTION  : Decompresses a zstd file into the pipe (files of several frames are decompressed one after another)
+// PARAMETERS   : DecompressStream* stream : File being decompressed
+//                unsigned char* in        : Buffer for compressed bytes
+//                unsigned char* out       : Buffer for decompressed bytes
+//                size_t size              : Size of each buffer
+// RETURNS      : void
+//
+static void DecompressZstd(DecompressStream* stream, unsigned char* in, unsigned char* out, size_t size) {
+	ZSTD_DStream* zstd = ZSTD_createDStream();
+	if (zstd == NULL) {
+		fprintf(stderr, "Insufficient memory to decompress file.\n");
+		return;
+	}
+	ZSTD_initDStream(zstd);
+
+	size_t remaining = 0; // Non-zero while a frame is not finished
+	int bytes = 0;
+	bool error = false;
+	while (!error && (bytes = ReadInput(stream, in, size)) > 0) {
+		ZSTD_inBuffer input = { in, (size_t)bytes, 0 };
+		ZSTD_outBuffer output = { out, size, 0 };
+
+		// Keep going while there is input, or while output is left over from a full buffer
+		do {
+			output.pos = 0;
+			remaining = ZSTD_decompressStream(zstd, &output, &input);
+			if (ZSTD_isError(remaining)) {
+				fprintf(stderr, "Error decompressing file: %s.\n", ZSTD_getErrorName(remaining));
+				error = true;
+				break;
+			}
+			if (!WriteOutput(stream, out, output.pos)) {
+				error = true;
+				break;
+			}
+		} while (input.pos < input.size || output.pos == output.size);
+	}
+
+	if (bytes < 0) {
+		fprintf(stderr, "Error reading file.\n");
+	}
+	else if (!error && remaining != 0) {
+		fprintf(stderr, "Error decompressing file: the zstd data ends early.\n");
+	}
+	ZSTD_freeDStream(zstd);
+}
+
+//
+// FUNCTION     : CopyPlain
+// DESCRIPTION  : Copies a file that is not compressed into the pipe (used for pipes, whose first bytes cannot be put
+//                back once they are read). Bytes are passed on as soon as they arrive
+// PARAMETERS   : DecompressStream* stream : File being copied
+//                unsigned char* in        : Buffer for the bytes read
+//                size_t size              : Size of the buffer
+// RETURNS      : void
+//
+static void CopyPlain(DecompressStream* stream, unsigned char* in, size_t size) {
+	int bytes = 0;
+	while ((bytes = ReadInput(stream, in, size)) > 0) {
+		if (!WriteOutput(stream, in, bytes)) {
+			return;
+		}
+	}
+	if (bytes < 0) {
+		fprintf(stderr, "Error reading file.\n");
+	}
+}
+
+//
+// FUNCTION     : DecompressWorker
+// DESCRIPTION  : Runs on the decompression thread of a file - decompresses the whole file into the pipe, then closes
+//                the pipe so the import reaches the end of the file
+// PARAMETERS   : DecompressStream* stream : File being decompressed
+// RETURNS      : void
+//
+static void DecompressWorker(DecompressStream* stream) {
+	unsigned char* in = (unsigned char*)malloc(READ_BLOCK_SIZE);
+	unsigned char* out = (unsigned char*)malloc(READ_BLOCK_SIZE);
+	if (in == NULL || out == NULL) {
+		fprintf(stderr, "Insufficient memory to decompress file. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+
+	switch (stream->Format) {
+	case INPUT_GZIP:
+		InflateGzip(stream, in, out, READ_BLOCK_SIZE);
+		break;
+	case INPUT_ZSTD:
+		DecompressZstd(stream, in, out, READ_BLOCK_SIZE);
+		break;
+	default:
+		CopyPlain(stream, in, READ_BLOCK_SIZE);
+		break;
+	}
+
+	_close(stream->Pipe);
+	free(in);
+	free(out);
+}
+
+//
+// FUNCTION     : openImportStream
+// DESCRIPTION  : Prepares a file for importing. A file compressed with gzip or zstd (found by its first bytes, not its
+//                name) is decompressed on a separate thread, and the decompressed text is returned as a file to read.
+//                A plain file is returned as it is, unless its first bytes cannot be put back (a pipe), in which case
+//                it is passed through the same way
+// PARAMETERS   : FILE* file : File opened for reading in binary mode that nothing has been read from
+// RETURNS      : FILE*      : File to read the text from - must be closed with closeImportStream
+//
+FILE* openImportStream(FILE* file) {
+	int fd = _fileno(file);
+	unsigned char magic[4];
+	size_t length = 0;
+	_setmode(fd, _O_BINARY); // Standard input is opened in text mode
+
+	// Read the first bytes directly, so nothing is held in the file's buffer
+	while (length < sizeof(magic)) {
+		int bytes = _read(fd, magic + length, (unsigned int)(sizeof(magic) - length));
+		if (bytes <= 0) {
+			break;
+		}
+		length += bytes;
+	}
+
+	InputFormat format = INPUT_PLAIN;
+	if (length >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) {
+		format = INPUT_GZIP;
+	}
+	else if (length == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD) {
+		format = INPUT_ZSTD;
+	}
+
+	// Put the first bytes of a plain file back
+	struct _stat info;
+	if (format == INPUT_PLAIN && _fstat(fd, &info) == 0 && (info.st_mode & _S_IFREG) != 0 && _lseek(fd, -(long)length, SEEK_CUR) != -1) {
+		return file;
+	}
+
+	DecompressStream* stream = new DecompressStream();
+	int ends[2];
+	if (_pipe(ends, READ_BLOCK_SIZE, _O_BINARY) != 0) {
+		perror("Error decompressing file.");
+		exit(EXIT_FAILURE);
+	}
+	stream->Output = _fdopen(ends[0], "rb");
+	if (stream->Output == NULL) {
+		perror("Error decompressing file.");
+		exit(EXIT_FAILURE);
+	}
+	stream->Input = file;
+	stream->Pipe = ends[1];
+	stream->Format = format;
+	memcpy(stream->Magic, magic, length);
+	stream->MagicLength = length;
+
+	stream->Next = gDecompressStreams;
+	gDecompressStreams = stream;
+	stream->Thread = std::thread(DecompressWorker, stream);
+	return stream->Output;
+}
+
+//
+// FUNCTION     : closeImportStream
+// DESCRIPTION  : Closes a file returned by openImportStream, waiting for its decompression thread to finish and
+//                closing the file it decompressed
+// PARAMETERS   : FILE* file : File to close
+// RETURNS      : int        : 0 if the file was closed, EOF otherwise (like fclose)
+//
+int closeImportStream(FILE* file) {
+	DecompressStream** link = &gDecompressStreams;
+	while (*link != NULL && (*link)->Output != file) {
+		link = &(*link)->Next;
+	}
+	if (*link == NULL) {
+		return fclose(file);
+	}
+
+	// Closing the read end first stops a thread whose output is no longer read
+	DecompressStream* stream = *link;
+	*link = stream->Next;
+	int result = fclose(stream->Output);
+	stream->Thread.join();
+	if (fclose(stream->Input) != 0) {
+		result = EOF;
+	}
+	delete stream;
+	return result;
+}
@@ -55,33 +55,23 @@ void SaveFile(FILE* file, CitationManager* Citations, Stack* ProcessedCitations)
 		exit(EXIT_FAILURE);
 	}
 
-	// Iterate through stack and write to file
-	Citation* current = ProcessedCitations->Top;
-	Citation* next = NULL;
+	// Pop each citation from the stack and write to file
+	Citation* current = NULL;
 	int index = 0; // Create unique citekey by adding counter
-	char bib[BIB_SIZE]; // Store string to write to file
-
-	while (current != NULL) {
-		if (current->Year != 0) {
-			sprintf_s(bib, BIB_SIZE, "@online{WebsiteCiteKey%d,\n\tauthor = {%s},\n\ttitle = {%s},\n\tyear = {%d},\n\turl = {%s},\n\turldate = {%s}\n}\n", index, current->Author, current->Title, current->Year, current->URL, current->DateAccessed);
-			fprintf(file, bib);
-		}
-		else {
-			sprintf_s(bib, BIB_SIZE, "@online{WebsiteCiteKey%d,\n\tauthor = {%s},\n\ttitle = {%s},\n\tyear = {},\n\turl = {%s},\n\turldate = {%s}\n}\n", index, current->Author, current->Title, current->URL, current->DateAccessed);
-			fprintf(file, bib);
-		}
+	BibWriter writer; // Collects the entries and writes them in large blocks
+	InitializeBibWriter(&writer, file);
 
+	while (!isStackEmpty(ProcessedCitations)) {
+		current = Pop(ProcessedCitations);
+		writeCitation(&writer, current, index);
 		index++; // Increase counter for citekey
-		next = current->Next; // Store next pointer
 
 		// Free memory
-		DeleteHashTable(Citations, SearchKVPHashTable(Citations, current->URL)); // Delete citation from hash table
-		current = Pop(ProcessedCitations); // Pop the citation from the stack after processing
-		if (current != NULL) {
-			free(current);
-		}
-
-		current = next; // Move pointer
+		DeleteHashTable(Citations, SearchKVPHashTable(Citations, GetCitationURL(current))); // Delete citation from hash table
+		FreeCitation(current);
+	}
+	if (!FreeBibWriter(&writer)) {
+		printf("Error writing file.\n");
 	}
 
 	// Close the file safely
@@ -93,9 +83,169 @@ void SaveFile(FILE* file, CitationManager* Citations, Stack* ProcessedCitations)
 	printf("Data saved to file successfully.\n");
 }
 
+//
+// FUNCTION     : InitializeBibWriter
+// DESCRIPTION  : Initializes a writer of BibLaTeX entries for a file opened for writing
+// PARAMETERS   : BibWriter* writer : Writer to initialize
+//				  FILE* file		: File to write to (not closed by the writer)
+// RETURNS      : void
+//
+void InitializeBibWriter(BibWriter* writer, FILE* file) {
+	writer->File = file;
+	writer->Capacity = WRITE_BLOCK_SIZE;
+	writer->Buffer = (char*)malloc(writer->Capacity);
+	if (writer->Buffer == NULL) {
+		printf("Insufficient memory to export citations. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	writer->Length = 0;
+	writer->Error = false;
+}
+
+//
+// FUNCTION     : FlushBibWriter
+// DESCRIPTION  : Writes the entries collected by a writer to its file and flushes the file
+// PARAMETERS   : BibWriter* writer : Writer to flush
+// RETURNS      : bool				: false if a write to the file has failed
+//
+bool FlushBibWriter(BibWriter* writer) {
+	if (writer->Length > 0 && fwrite(writer->Buffer, 1, writer->Length, writer->File) != writer->Length) {
+		writer->Error = true;
+	}
+	writer->Length = 0;
+	if (fflush(writer->File) != 0) {
+		writer->Error = true;
+	}
+	return !writer->Error;
+}
+
+//
+// FUNCTION     : FreeBibWriter
+// DESCRIPTION  : Writes what is left in a writer to its file and frees its buffer
+// PARAMETERS   : BibWriter* writer : Writer to free
+// RETURNS      : bool				: false if a write to the file has failed
+//
+bool FreeBibWriter(BibWriter* writer) {
+	bool written = FlushBibWriter(writer);
+	free(writer->Buffer);
+	writer->Buffer = NULL;
+	writer->Capacity = 0;
+	return written;
+}
+
+//
+// FUNCTION     : ReserveBib
+// DESCRIPTION  : Makes room for a number of bytes in a writer's buffer, writing the buffer to the file once it is full
+//				  and growing it if the bytes do not fit in an empty buffer
+// PARAMETERS   : BibWriter* writer : Writer to make room in
+//				  size_t length		: Number of bytes needed
+// RETURNS      : char*				: Where the bytes go in the buffer
+//
+static char* ReserveBib(BibWriter* writer, size_t length) {
+	if (writer->Length + length > writer->Capacity) {
+		if (writer->Length > 0 && fwrite(writer->Buffer, 1, writer->Length, writer->File) != writer->Length) {
+			writer->Error = true;
+		}
+		writer->Length = 0;
+
+		if (length > writer->Capacity) {
+			size_t capacity = writer->Capacity;
+			while (length > capacity) {
+				capacity *= 2;
+			}
+			char* buffer = (char*)realloc(writer->Buffer, capacity);
+			if (buffer == NULL) {
+				printf("Insufficient memory to export citations. Exiting program...\n");
+				exit(EXIT_FAILURE);
+			}
+			writer->Buffer = buffer;
+			writer->Capacity = capacity;
+		}
+	}
+	return writer->Buffer + writer->Length;
+}
+
+//
+// FUNCTION     : AppendBib
+// DESCRIPTION  : Appends text to a writer's buffer as it is (a '%' is not a format specifier)
+// PARAMETERS   : BibWriter* writer : Writer to append to
+//				  const char* text	: Text to append
+//				  size_t length		: Length of text
+// RETURNS      : void
+//
+static inline void AppendBib(BibWriter* writer, const char* text, size_t length) {
+	memcpy(ReserveBib(writer, length), text, length);
+	writer->Length += length;
+}
+
+//
+// FUNCTION     : AppendNumber
+// DESCRIPTION  : Appends a number in decimal to a writer's buffer, padded with zeros to a minimum number of digits
+// PARAMETERS   : BibWriter* writer : Writer to append to
+//				  unsigned int value: Number to append
+//				  int width			: Minimum number of digits
+// RETURNS      : void
+//
+static void AppendNumber(BibWriter* writer, unsigned int value, int width) {
+	char digits[16];
+	int count = 0;
+	do {
+		digits[count++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value > 0 || count < width);
+
+	char* out = ReserveBib(writer, count);
+	for (int i = 0; i < count; i++) {
+		out[i] = digits[count - 1 - i];
+	}
+	writer->Length += count;
+}
+
+// Appends a string literal without measuring it
+#define APPEND_LITERAL(writer, text) AppendBib((writer), (text), sizeof(text) - 1)
+
+//
+// FUNCTION     : writeCitation
+// DESCRIPTION  : Writes a citation as a BibLaTeX @online entry and marks it as exported. The entry is appended to the
+//				  writer's buffer field by field, so fields of any length are written in full
+// PARAMETERS   : BibWriter* writer		: Writer of the export file for citations
+//				  Citation* citation	: Citation to write
+//				  int index				: Number added to the citekey to make it unique
+// RETURNS      : void
+//
+void writeCitation(BibWriter* writer, Citation* citation, int index) {
+	const char* author = GetCitationAuthor(citation);
+	const char* title = GetCitationTitle(citation);
+	const char* url = GetCitationURL(citation);
+	int year = GetCitationYear(citation);
+	PackedDate date = GetCitationDateAccessed(citation);
+
+	SetCitationState(citation, CITATION_EXPORTED);
+
+	APPEND_LITERAL(writer, "@online{WebsiteCiteKey");
+	AppendNumber(writer, (unsigned int)index, 1);
+	APPEND_LITERAL(writer, ",\n\tauthor = {");
+	AppendBib(writer, author, strlen(author));
+	APPEND_LITERAL(writer, "},\n\ttitle = {");
+	AppendBib(writer, title, strlen(title));
+	APPEND_LITERAL(writer, "},\n\tyear = {");
+	if (year != 0) {
+		AppendNumber(writer, (unsigned int)year, 1);
+	}
+	APPEND_LITERAL(writer, "},\n\turl = {");
+	AppendBib(writer, url, strlen(url));
+	APPEND_LITERAL(writer, "},\n\turldate = {");
+	AppendNumber(writer, date >> 9, 4);
+	APPEND_LITERAL(writer, "-");
+	AppendNumber(writer, (date >> 5) & 0xF, 2);
+	APPEND_LITERAL(writer, "-");
+	AppendNumber(writer, date & 0x1F, 2);
+	APPEND_LITERAL(writer, "}\n}\n");
+}
+
 //
 // FUNCTION     : exportCitationsFile
-// DESCRIPTION  : Saves data from queue to a given filename
+// DESCRIPTION  : Saves data from queue to a given filename ("-" writes to standard output)
 // PARAMETERS   : FILE* file				: Pointer to export file for citations
 //				  Queue* CitationsToProcess	: Queue to store citations that need to be processed
 //				  const char* url			: URL of website to be stored
@@ -103,40 +253,68 @@ void SaveFile(FILE* file, CitationManager* Citations, Stack* ProcessedCitations)
 //
 void exportCitationsFile(FILE* ExportFile, Queue* CitationsToProcess, const char* filename) {
 	// Open file for writing safely or creates it if it does not exist
+	ExportFile = openExportFile(filename);
+
+	// Dequeue each citation and write to file
+	Citation* current = NULL;
+	int index = 0; // Create unique citekey by adding counter
+	BibWriter writer; // Collects the entries and writes them in large blocks
+	InitializeBibWriter(&writer, ExportFile);
+
+	while (!isQueueEmpty(CitationsToProcess)) {
+		current = Dequeue(CitationsToProcess);
+		writeCitation(&writer, current, index);
+		index++; // Increase counter for citekey
+	}
+	if (!FreeBibWriter(&writer)) {
+		fprintf(stderr, "Error writing file.\n");
+	}
+
+	// Close the file safely
+	closeExportFile(ExportFile);
+}
+
+//
+// FUNCTION     : openExportFile
+// DESCRIPTION  : Opens a file for writing citations, creating it if it does not exist - exits the program if the file
+//				  cannot be opened
+// PARAMETERS   : const char* filename : Name of the file ("-" for standard output)
+// RETURNS      : FILE*
+//
+FILE* openExportFile(const char* filename) {
+	if (strcmp(filename, "-") == 0) {
+		return stdout;
+	}
+
+	// Open file for writing safely or creates it if it does not exist
+	FILE* file = NULL;
 	errno_t err;
-	err = fopen_s(&ExportFile, filename, "w+");
+	err = fopen_s(&file, filename, "w+");
 
 	// Exit if there is a failure to open file
 	if (err != 0) {
 		perror("Error opening file.");
 		exit(EXIT_FAILURE);
 	}
+	return file;
+}
 
-	// Iterate through queue and write to file
-	Citation* current = CitationsToProcess->Front;
-	Citation* next = NULL;
-	int index = 0; // Create unique citekey by adding counter
-	char bib[BIB_SIZE]; // Store string to write to file
-
-	while (current != NULL) {
-		if (current->Year != 0) {
-			sprintf_s(bib, BIB_SIZE, "@online{WebsiteCiteKey%d,\n\tauthor = {%s},\n\ttitle = {%s},\n\tyear = {%d},\n\turl = {%s},\n\turldate = {%s}\n}\n", index, current->Author, current->Title, current->Year, current->URL, current->DateAccessed);
-			fprintf(ExportFile, bib);
-		}
-		else {
-			sprintf_s(bib, BIB_SIZE, "@online{WebsiteCiteKey%d,\n\tauthor = {%s},\n\ttitle = {%s},\n\tyear = {},\n\turl = {%s},\n\turldate = {%s}\n}\n", index, current->Author, current->Title, current->URL, current->DateAccessed);
-			fprintf(ExportFile, bib);
+//
+// FUNCTION     : closeExportFile
+// DESCRIPTION  : Closes a file opened with openExportFile (standard output is only flushed)
+// PARAMETERS   : FILE* file : File to close
+// RETURNS      : void
+//
+void closeExportFile(FILE* file) {
+	if (file == stdout) {
+		if (fflush(stdout) != 0) {
+			fprintf(stderr, "Error writing to standard output.\n");
 		}
-
-		index++; // Increase counter for citekey
-		next = current->Next; // Store next pointer
-		Dequeue(CitationsToProcess); // Dequeue the citation from the stack after processing
-		current = next; // Move pointer
+		return;
 	}
 
 	// Close the file safely
-	if (fclose(ExportFile) != 0) {
+	if (fclose(file) != 0) {
 		printf("Error closing file.\n");
-		return;
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,381 @@
+/*
+* FILE          : HashFunctions.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the hash functions that can be plugged into the hash table and a report that
+*                 compares their speed and distribution over a file of URLs
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "Citations.h"
+
+// Define constants for HashFast
+#define PRIME64_1	0x9E3779B185EBCA87ULL
+#define PRIME64_2	0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3	0x165667B19E3779F9ULL
+#define PRIME64_4	0x85EBCA77C2B2AE63ULL
+#define PRIME64_5	0x27D4EB2F165667C5ULL
+
+// Number of times the report hashes the whole file to time each function
+#define REPORT_PASSES	10
+// Number of colliding keys the report prints for each hash function
+#define REPORT_COLLISIONS_SHOWN	5
+
+// Define hash functions compared by hashReport
+typedef struct NamedHashFunction {
+	const char* Name;
+	HashFunction Function;
+} NamedHashFunction;
+
+// Define hash paired with the key it came from (for counting collisions and showing the keys that collided)
+typedef struct ReportHash {
+	unsigned long long Hash;
+	int Key;
+} ReportHash;
+
+// Define probe statistics of one simulated shard of the hash table
+typedef struct ShardReport {
+	int Count; // Keys placed in the shard
+	unsigned int Capacity; // Slots the shard would grow to
+	unsigned long long TotalProbes;
+	unsigned int MaxProbes;
+	unsigned int FullGroups;
+} ShardReport;
+
+//
+// FUNCTION     : HashDJB2
+// DESCRIPTION  : Hashing function for use of storing citations in the hash table (CitationManager)
+//                This hash function is a modification of a hash function that was developed by Daniel J. Bernstein
+//                in 1991 and is colloquially known as the "djb2 Hash"
+//                The hash is computed in 64 bits and finished with a bit mixer, since the index uses the low 7 bits
+//                as the control byte and the high bits to pick the group to probe
+// PARAMETERS   : const char* str       :   The string to hash (URL)
+//                size_t length         :   Length of the string
+// RETURNS      : unsigned long long    :   The hashed string (hashed URL)
+//
+/*
+* TITLE         : djb2 Hash
+* AUTHOR        : Daniel J. Bernstein
+* DATE          : 1991
+* VERSION       : 1.0
+* AVAILABIILTY  : https://theartincode.stanis.me/008-djb2/
+*/
+unsigned long long HashDJB2(const char* str, size_t length)
+{
+	unsigned long long hash = 5381;
+	for (size_t i = 0; i < length; i++)
+		hash = ((hash << 5) + hash) + str[i];
+
+	// Mix all bits of the hash into the low and high bits
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+//
+// FUNCTION     : RotateLeft
+// DESCRIPTION  : Rotates the bits of a 64-bit value to the left
+// PARAMETERS   : unsigned long long value  : Value to rotate
+//                int bits                  : Number of bits to rotate by
+// RETURNS      : unsigned long long
+//
+static unsigned long long RotateLeft(unsigned long long value, int bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+//
+// FUNCTION     : ReadWord
+// DESCRIPTION  : Reads 8 bytes of a string as a 64-bit little-endian word (no alignment needed)
+// PARAMETERS   : const unsigned char* p : Pointer to the first byte
+// RETURNS      : unsigned long long
+//
+static unsigned long long ReadWord(const unsigned char* p) {
+	unsigned long long word;
+	memcpy(&word, p, sizeof(word));
+	return word;
+}
+
+//
+// FUNCTION     : HashRound
+// DESCRIPTION  : Mixes one 64-bit word into an accumulator
+// PARAMETERS   : unsigned long long acc    : Accumulator
+//                unsigned long long word   : Word of input
+// RETURNS      : unsigned long long
+//
+static unsigned long long HashRound(unsigned long long acc, unsigned long long word) {
+	acc += word * PRIME64_2;
+	acc = RotateLeft(acc, 31);
+	return acc * PRIME64_1;
+}
+
+//
+// FUNCTION     : HashFast
+// DESCRIPTION  : Word-at-a-time hash based on XXH64. Long URLs are consumed 32 bytes per step with four independent
+//                accumulators, so every byte of a shared scheme/host/path prefix still affects all bits of the result
+// PARAMETERS   : const char* str       :   The string to hash (URL)
+//                size_t length         :   Length of the string
+// RETURNS      : unsigned long long    :   The hashed string (hashed URL)
+//
+/*
+* TITLE         : xxHash - Extremely fast hash algorithm
+* AUTHOR        : Yann Collet
+* DATE          : 2012
+* VERSION       : XXH64
+* AVAILABIILTY  : https://github.com/Cyan4973/xxHash
+*/
+unsigned long long HashFast(const char* str, size_t length) {
+	const unsigned char* p = (const unsigned char*)str;
+	const unsigned char* end = p + length;
+	unsigned long long hash;
+
+	if (length >= 32) {
+		// Four independent lanes of 8 bytes each
+		unsigned long long v1 = PRIME64_1 + PRIME64_2;
+		unsigned long long v2 = PRIME64_2;
+		unsigned long long v3 = 0;
+		unsigned long long v4 = 0ULL - PRIME64_1;
+
+		while (p + 32 <= end) {
+			v1 = HashRound(v1, ReadWord(p));
+			v2 = HashRound(v2, ReadWord(p + 8));
+			v3 = HashRound(v3, ReadWord(p + 16));
+			v4 = HashRound(v4, ReadWord(p + 24));
+			p += 32;
+		}
+
+		hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+		hash = (hash ^ HashRound(0, v1)) * PRIME64_1 + PRIME64_4;
+		hash = (hash ^ HashRound(0, v2)) * PRIME64_1 + PRIME64_4;
+		hash = (hash ^ HashRound(0, v3)) * PRIME64_1 + PRIME64_4;
+		hash = (hash ^ HashRound(0, v4)) * PRIME64_1 + PRIME64_4;
+	}
+	else {
+		hash = PRIME64_5;
+	}
+
+	hash += (unsigned long long)length;
+
+	// Remaining words, half-word and bytes
+	while (p + 8 <= end) {
+		hash ^= HashRound(0, ReadWord(p));
+		hash = RotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+		p += 8;
+	}
+	if (p + 4 <= end) {
+		unsigned int half;
+		memcpy(&half, p, sizeof(half));
+		hash ^= (unsigned long long)half * PRIME64_1;
+		hash = RotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	while (p < end) {
+		hash ^= (*p) * PRIME64_5;
+		hash = RotateLeft(hash, 11) * PRIME64_1;
+		p++;
+	}
+
+	// Final avalanche
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+//
+// FUNCTION     : CompareReportHash
+// DESCRIPTION  : qsort comparison function to order hashes
+// PARAMETERS   : const void* a : First ReportHash
+//                const void* b : Second ReportHash
+// RETURNS      : int
+//
+static int CompareReportHash(const void* a, const void* b) {
+	unsigned long long hashA = ((const ReportHash*)a)->Hash;
+	unsigned long long hashB = ((const ReportHash*)b)->Hash;
+	return (hashA > hashB) - (hashA < hashB);
+}
+
+//
+// FUNCTION     : SimulateShards
+// DESCRIPTION  : Places hashes in a model of the hash table in the order they were read. Each hash goes to the shard
+//                picked by its top bits, every shard is sized the way it would grow for the hashes it holds, and the
+//                same group probing as the hash table is used
+// PARAMETERS   : const unsigned long long* hashes : Hashes of the different keys
+//                int count                        : Number of hashes
+//                ShardReport* shards              : Stores the result for each of the HASH_SHARDS shards
+// RETURNS      : void
+//
+static void SimulateShards(const unsigned long long* hashes, int count, ShardReport* shards) {
+	unsigned int* groupLoad[HASH_SHARDS];
+
+	memset(shards, 0, HASH_SHARDS * sizeof(ShardReport));
+	for (int i = 0; i < count; i++) {
+		shards[(hashes[i] >> 58) & (HASH_SHARDS - 1)].Count++;
+	}
+	for (int s = 0; s < HASH_SHARDS; s++) {
+		shards[s].Capacity = HASH_TABLE_SIZE;
+		while ((unsigned long long)shards[s].Count * 100 > (unsigned long long)shards[s].Capacity * HASH_MAX_LOAD) {
+			shards[s].Capacity *= 2;
+		}
+		groupLoad[s] = (unsigned int*)calloc(shards[s].Capacity / HASH_GROUP_WIDTH, sizeof(unsigned int));
+		if (groupLoad[s] == NULL) {
+			printf("Insufficient memory to create report. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		ShardReport* shard = &shards[(hashes[i] >> 58) & (HASH_SHARDS - 1)];
+		unsigned int* load = groupLoad[shard - shards];
+		unsigned int groupMask = shard->Capacity / HASH_GROUP_WIDTH - 1;
+		unsigned int group = (unsigned int)(hashes[i] >> 7) & groupMask;
+		unsigned int probes = 1;
+		while (load[group] == HASH_GROUP_WIDTH) {
+			group = (group + probes) & groupMask;
+			probes++;
+		}
+		load[group]++;
+		shard->TotalProbes += probes;
+		if (probes > shard->MaxProbes) {
+			shard->MaxProbes = probes;
+		}
+	}
+
+	for (int s = 0; s < HASH_SHARDS; s++) {
+		for (unsigned int g = 0; g < shards[s].Capacity / HASH_GROUP_WIDTH; g++) {
+			if (groupLoad[s][g] == HASH_GROUP_WIDTH) {
+				shards[s].FullGroups++;
+			}
+		}
+		free(groupLoad[s]);
+	}
+}
+
+//
+// FUNCTION     : hashReport
+// DESCRIPTION  : Reads a file of URLs and prints, for every hash function, its throughput over the keys the hash table
+//                would hash, the number of full 64-bit collisions between different keys, and for each shard of the
+//                hash table how many keys it would hold and how long its probe sequences would be
+// PARAMETERS   : const char* filename : Name of file containing line-separated URLs
+// RETURNS      : void
+//
+void hashReport(const char* filename) {
+	FILE* file = NULL;
+	errno_t err = fopen_s(&file, filename, "rb");
+	if (err != 0) {
+		perror("Error opening file.");
+		return;
+	}
+
+	URLList keys;
+	ReadURLList(file, &keys);
+	if (keys.Count == 0) {
+		printf("No URLs found in %s.\n", filename);
+		FreeURLList(&keys);
+		return;
+	}
+	size_t totalBytes = 0;
+	for (int i = 0; i < keys.Count; i++) {
+		totalBytes += keys.KeyLengths[i];
+	}
+
+	NamedHashFunction functions[] = {
+		{ "djb2+mix", HashDJB2 },
+		{ "fast", HashFast }
+	};
+	int functionCount = sizeof(functions) / sizeof(functions[0]);
+
+	unsigned long long* values = (unsigned long long*)malloc(keys.Count * sizeof(unsigned long long));
+	ReportHash* hashes = (ReportHash*)malloc(keys.Count * sizeof(ReportHash));
+	if (values == NULL || hashes == NULL) {
+		printf("Insufficient memory to create report. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+
+	printf("\nHash Report: %d URLs (%d different keys, %.2f MB of keys) in %s\n", keys.Read, keys.Count, totalBytes / 1e6, filename);
+	printf("Keys are canonical URLs without their scheme, spread over %d shards by the top bits of their hash\n", HASH_SHARDS);
+
+	for (int f = 0; f < functionCount; f++) {
+		HashFunction hashFunction = functions[f].Function;
+
+		// Throughput (checksum is volatile so the hashing is not optimized away)
+		volatile unsigned long long checksum = 0;
+		clock_t start = clock();
+		for (int pass = 0; pass < REPORT_PASSES; pass++) {
+			for (int i = 0; i < keys.Count; i++) {
+				checksum += hashFunction(keys.Text + keys.Keys[i], keys.KeyLengths[i]);
+			}
+		}
+		double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+		double throughput = seconds > 0 ? (double)totalBytes * REPORT_PASSES / seconds / 1e6 : 0;
+
+		for (int i = 0; i < keys.Count; i++) {
+			values[i] = hashFunction(keys.Text + keys.Keys[i], keys.KeyLengths[i]);
+			hashes[i].Hash = values[i];
+			hashes[i].Key = i;
+		}
+
+		// Count different keys with the same 64-bit hash (repeated keys were already dropped)
+		qsort(hashes, keys.Count, sizeof(ReportHash), CompareReportHash);
+		int collisions = 0;
+		for (int i = 1; i < keys.Count; i++) {
+			if (hashes[i].Hash == hashes[i - 1].Hash) {
+				collisions++;
+			}
+		}
+
+		ShardReport shards[HASH_SHARDS];
+		SimulateShards(values, keys.Count, shards);
+
+		printf("------------------------------------------------------------------------------\n");
+		printf("%s: %.1f MB/s, %d collisions\n", functions[f].Name, throughput, collisions);
+
+		// Show the first few pairs of keys that collided
+		int shown = 0;
+		for (int i = 1; i < keys.Count && shown < REPORT_COLLISIONS_SHOWN; i++) {
+			if (hashes[i].Hash == hashes[i - 1].Hash) {
+				int a = hashes[i - 1].Key;
+				int b = hashes[i].Key;
+				printf("  %016llx: %.*s and %.*s\n", hashes[i].Hash, (int)keys.KeyLengths[a], keys.Text + keys.Keys[a],
+					(int)keys.KeyLengths[b], keys.Text + keys.Keys[b]);
+				shown++;
+			}
+		}
+		printf("%-6s %10s %10s %14s %14s %12s\n", "Shard", "Keys", "Slots", "Avg. probes", "Max probes", "Full groups");
+
+		ShardReport total;
+		memset(&total, 0, sizeof(total));
+		unsigned int totalGroups = 0;
+		for (int s = 0; s < HASH_SHARDS; s++) {
+			unsigned int groups = shards[s].Capacity / HASH_GROUP_WIDTH;
+			printf("%-6d %10d %10u %14.3f %14u %11.1f%%\n", s, shards[s].Count, shards[s].Capacity,
+				shards[s].Count > 0 ? (double)shards[s].TotalProbes / shards[s].Count : 0.0, shards[s].MaxProbes,
+				100.0 * shards[s].FullGroups / groups);
+
+			total.Count += shards[s].Count;
+			total.Capacity += shards[s].Capacity;
+			total.TotalProbes += shards[s].TotalProbes;
+			total.FullGroups += shards[s].FullGroups;
+			totalGroups += groups;
+			if (shards[s].MaxProbes > total.MaxProbes) {
+				total.MaxProbes = shards[s].MaxProbes;
+			}
+		}
+		printf("%-6s %10d %10u %14.3f %14u %11.1f%%\n", "All", total.Count, total.Capacity,
+			(double)total.TotalProbes / total.Count, total.MaxProbes, 100.0 * total.FullGroups / totalGroups);
+	}
+
+	// Memory cleanup
+	FreeURLList(&keys);
+	free(values);
+	free(hashes);
+}
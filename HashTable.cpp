@@ -11,35 +11,101 @@
 #include <stdbool.h>
 #include <string.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_USE_SSE2
+#endif
+
 #include "Citations.h"
 
+// Define control bytes
+#define CTRL_EMPTY		0x80
+#define CTRL_DELETED	0xFE
+
+// Internal functions
+static void FreeHashIndex(HashIndex* index);
+static void PlaceKVP(HashIndex* index, CitationKVP* kvp);
+static CitationKVP* FindKVP(HashShard* shard, unsigned long long hash, const char* key);
+
 //
-// FUNCTION     : Hash
-// DESCRIPTION  : Hashing function for use of storing citations in the hash table (CitationManager)
-//                This hash function is a modification of a hash function that was developed by Daniel J. Bernstein
-//                in 1991 and is colloquially known as the "djb2 Hash"
-// PARAMETERS   : const char* str   :   The string to hash (URL)
-// RETURNS      : int               :   The hashed string (hashed URL) to store in hash table
+// FUNCTION     : ShardFor
+// DESCRIPTION  : Returns the shard that stores a hash (chosen by the top bits, which the index itself does not use)
+// PARAMETERS   : CitationManager* Citations : Hash table containing citations
+//                unsigned long long hash    : Hash of the key
+// RETURNS      : HashShard*
 //
-/*
-* TITLE         : djb2 Hash
-* AUTHOR        : Daniel J. Bernstein
-* DATE          : 1991
-* VERSION       : 1.0
-* AVAILABIILTY  : https://theartincode.stanis.me/008-djb2/
-*/
-unsigned int Hash(const char* str)
-{
-    unsigned int hash = 5381;
-    int c;
-    while (c = *str++)
-        hash = ((hash << 5) + hash) + c;
-    return hash % HASH_TABLE_SIZE;
+static HashShard* ShardFor(CitationManager* Citations, unsigned long long hash) {
+    return &Citations->Shards[(hash >> 58) & (HASH_SHARDS - 1)];
+}
+
+//
+// FUNCTION     : MatchByte
+// DESCRIPTION  : Compares every control byte in a group against a value
+// PARAMETERS   : const unsigned char* group : Pointer to the first control byte of the group
+//                unsigned char value        : Control byte to look for
+// RETURNS      : unsigned int               : Bit mask with bit i set if control byte i matches
+//
+static unsigned int MatchByte(const unsigned char* group, unsigned char value) {
+#if defined(__AVX2__)
+    __m256i ctrl = _mm256_loadu_si256((const __m256i*)group);
+    return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(ctrl, _mm256_set1_epi8((char)value)));
+#elif defined(HASH_USE_SSE2)
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)value)));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < HASH_GROUP_WIDTH; i++) {
+        if (group[i] == value) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+//
+// FUNCTION     : MatchFree
+// DESCRIPTION  : Finds every empty or deleted control byte in a group (both have the high bit set)
+// PARAMETERS   : const unsigned char* group : Pointer to the first control byte of the group
+// RETURNS      : unsigned int               : Bit mask with bit i set if slot i is free
+//
+static unsigned int MatchFree(const unsigned char* group) {
+#if defined(__AVX2__)
+    return (unsigned int)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)group));
+#elif defined(HASH_USE_SSE2)
+    return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < HASH_GROUP_WIDTH; i++) {
+        if (group[i] & 0x80) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+//
+// FUNCTION     : LowestBit
+// DESCRIPTION  : Returns the index of the lowest set bit of a non-zero mask
+// PARAMETERS   : unsigned int mask : Bit mask from MatchByte or MatchFree
+// RETURNS      : unsigned int
+//
+static unsigned int LowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
 }
 
 //
 // FUNCTION     : InitializeHashTable
-// DESCRIPTION  : Dynamically allocates memory for hash table and initializes all values as NULL
+// DESCRIPTION  : Dynamically allocates memory for hash table and initializes all slots as empty
 // PARAMETERS   : none
 // RETURNS      : CitationManager*
 //
@@ -51,21 +117,287 @@ CitationManager* InitializeHashTable(void) {
         exit(EXIT_FAILURE);
     }
 
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        hashTable->Table[i] = NULL;
+    for (int i = 0; i < HASH_SHARDS; i++) {
+        HashShard* shard = &hashTable->Shards[i];
+        InitializeHashIndex(&shard->Current, HASH_TABLE_SIZE);
+        shard->Old.Control = NULL;
+        shard->Old.Slots = NULL;
+        shard->Old.Capacity = 0;
+        shard->Old.Count = 0;
+        shard->Old.Tombstones = 0;
+        shard->MigrateIndex = 0;
+        shard->Lock = new std::mutex();
     }
+    hashTable->HashURL = HashFast;
+    InitializeIndexes(&hashTable->Indexes);
 
     return hashTable;
 }
 
+//
+// FUNCTION     : SetHashFunction
+// DESCRIPTION  : Changes the hash function used by the hash table. Any stored KVPs are rehashed, which can move them
+//                to a different shard, so every shard is locked while this runs
+// PARAMETERS   : CitationManager* Citations : Hash table containing citations
+//                HashFunction hashFunction  : Hash function to use (e.g. HashFast or HashDJB2)
+// RETURNS      : void
+//
+void SetHashFunction(CitationManager* Citations, HashFunction hashFunction) {
+    if (Citations->HashURL == hashFunction) {
+        return;
+    }
+
+    // Lock shards in order so this cannot deadlock with another SetHashFunction
+    for (int i = 0; i < HASH_SHARDS; i++) {
+        Citations->Shards[i].Lock->lock();
+    }
+
+    // Detach the index of every shard (finishing any resize in progress) and start with empty indexes
+    HashIndex previous[HASH_SHARDS];
+    for (int i = 0; i < HASH_SHARDS; i++) {
+        HashShard* shard = &Citations->Shards[i];
+        MigrateGroups(shard, shard->Old.Capacity);
+        previous[i] = shard->Current;
+        InitializeHashIndex(&shard->Current, previous[i].Capacity);
+    }
+    Citations->HashURL = hashFunction;
+
+    // Rehash every KVP into its new shard
+    for (int i = 0; i < HASH_SHARDS; i++) {
+        for (unsigned int slot = 0; slot < previous[i].Capacity; slot++) {
+            if ((previous[i].Control[slot] & 0x80) == 0) {
+                CitationKVP* kvp = previous[i].Slots[slot].KVP;
+                kvp->Hash = hashFunction(kvp->URL, strlen(kvp->URL));
+                HashIndex* index = &ShardFor(Citations, kvp->Hash)->Current;
+                if ((index->Count + 1) * 100 > index->Capacity * HASH_MAX_LOAD) {
+                    HashIndex full = *index;
+                    InitializeHashIndex(index, full.Capacity * 2);
+                    for (unsigned int moved = 0; moved < full.Capacity; moved++) {
+                        if ((full.Control[moved] & 0x80) == 0) {
+                            PlaceKVP(index, full.Slots[moved].KVP);
+                        }
+                    }
+                    FreeHashIndex(&full);
+                }
+                PlaceKVP(index, kvp);
+            }
+        }
+        FreeHashIndex(&previous[i]);
+    }
+
+    for (int i = HASH_SHARDS - 1; i >= 0; i--) {
+        Citations->Shards[i].Lock->unlock();
+    }
+}
+
+//
+// FUNCTION     : InitializeHashIndex
+// DESCRIPTION  : Dynamically allocates the control bytes and slots of an index and marks every slot empty
+// PARAMETERS   : HashIndex* index      : Index to initialize
+//                unsigned int capacity : Number of slots (power of 2, at least HASH_GROUP_WIDTH)
+// RETURNS      : void
+//
+void InitializeHashIndex(HashIndex* index, unsigned int capacity) {
+    if (capacity < HASH_GROUP_WIDTH) {
+        capacity = HASH_GROUP_WIDTH;
+    }
+
+    index->Control = (unsigned char*)malloc(capacity);
+    index->Slots = (HashSlot*)malloc(capacity * sizeof(HashSlot));
+
+    if (index->Control == NULL || index->Slots == NULL) {
+        printf("Insufficient memory to create hash table. Exiting program...\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(index->Control, CTRL_EMPTY, capacity);
+    index->Capacity = capacity;
+    index->Count = 0;
+    index->Tombstones = 0;
+}
+
+//
+// FUNCTION     : FreeHashIndex
+// DESCRIPTION  : Frees the control bytes and slots of an index (not the KVPs stored in it)
+// PARAMETERS   : HashIndex* index : Index to free
+// RETURNS      : void
+//
+static void FreeHashIndex(HashIndex* index) {
+    free(index->Control);
+    free(index->Slots);
+    index->Control = NULL;
+    index->Slots = NULL;
+    index->Capacity = 0;
+    index->Count = 0;
+    index->Tombstones = 0;
+}
+
+//
+// FUNCTION     : FindSlot
+// DESCRIPTION  : Probes an index group by group for a URL. Only slots whose control byte and cached hash both
+//                match are compared with strcmp
+// PARAMETERS   : HashIndex* index          : Index to search
+//                unsigned long long hash   : Full hash of the key
+//                const char* key           : Key to search for
+// RETURNS      : unsigned int              : Slot number, or index->Capacity if not found
+//
+static unsigned int FindSlot(HashIndex* index, unsigned long long hash, const char* key) {
+    unsigned char h2 = (unsigned char)(hash & 0x7F);
+    unsigned int groupMask = index->Capacity / HASH_GROUP_WIDTH - 1;
+    unsigned int group = (unsigned int)(hash >> 7) & groupMask;
+
+    // Triangular probing visits every group once when the number of groups is a power of 2
+    for (unsigned int probe = 1; probe <= groupMask + 1; probe++) {
+        const unsigned char* ctrl = index->Control + group * HASH_GROUP_WIDTH;
+        unsigned int match = MatchByte(ctrl, h2);
+        while (match != 0) {
+            unsigned int slot = group * HASH_GROUP_WIDTH + LowestBit(match);
+            if (index->Slots[slot].Hash == hash && strcmp(index->Slots[slot].KVP->URL, key) == 0) {
+                return slot;
+            }
+            match &= match - 1;
+        }
+
+        // An empty slot ends the probe sequence
+        if (MatchByte(ctrl, CTRL_EMPTY) != 0) {
+            break;
+        }
+        group = (group + probe) & groupMask;
+    }
+
+    return index->Capacity;
+}
+
+//
+// FUNCTION     : FindKVPSlot
+// DESCRIPTION  : Probes an index for the slot that holds a given KVP
+// PARAMETERS   : HashIndex* index  : Index to search
+//                CitationKVP* kvp  : KVP to search for
+// RETURNS      : unsigned int      : Slot number, or index->Capacity if not found
+//
+static unsigned int FindKVPSlot(HashIndex* index, CitationKVP* kvp) {
+    unsigned char h2 = (unsigned char)(kvp->Hash & 0x7F);
+    unsigned int groupMask = index->Capacity / HASH_GROUP_WIDTH - 1;
+    unsigned int group = (unsigned int)(kvp->Hash >> 7) & groupMask;
+
+    for (unsigned int probe = 1; probe <= groupMask + 1; probe++) {
+        const unsigned char* ctrl = index->Control + group * HASH_GROUP_WIDTH;
+        unsigned int match = MatchByte(ctrl, h2);
+        while (match != 0) {
+            unsigned int slot = group * HASH_GROUP_WIDTH + LowestBit(match);
+            if (index->Slots[slot].KVP == kvp) {
+                return slot;
+            }
+            match &= match - 1;
+        }
+        if (MatchByte(ctrl, CTRL_EMPTY) != 0) {
+            break;
+        }
+        group = (group + probe) & groupMask;
+    }
+
+    return index->Capacity;
+}
+
+//
+// FUNCTION     : PlaceKVP
+// DESCRIPTION  : Stores a KVP in the first free slot of its probe sequence (the URL must not already be stored)
+// PARAMETERS   : HashIndex* index  : Index to store the KVP in
+//                CitationKVP* kvp  : KVP to store
+// RETURNS      : void
+//
+static void PlaceKVP(HashIndex* index, CitationKVP* kvp) {
+    unsigned int groupMask = index->Capacity / HASH_GROUP_WIDTH - 1;
+    unsigned int group = (unsigned int)(kvp->Hash >> 7) & groupMask;
+    unsigned int probe = 1;
+    unsigned int freeSlots = MatchFree(index->Control + group * HASH_GROUP_WIDTH);
+
+    // The index is never allowed to fill up, so a free slot is always found
+    while (freeSlots == 0) {
+        group = (group + probe) & groupMask;
+        probe++;
+        freeSlots = MatchFree(index->Control + group * HASH_GROUP_WIDTH);
+    }
+
+    unsigned int slot = group * HASH_GROUP_WIDTH + LowestBit(freeSlots);
+    if (index->Control[slot] == CTRL_DELETED) {
+        index->Tombstones--;
+    }
+    index->Control[slot] = (unsigned char)(kvp->Hash & 0x7F);
+    index->Slots[slot].Hash = kvp->Hash;
+    index->Slots[slot].KVP = kvp;
+    index->Count++;
+}
+
+//
+// FUNCTION     : ResizeHashTable
+// DESCRIPTION  : Starts an incremental resize - the current index becomes the old index and a new index is allocated,
+//                which is then filled a few groups at a time by MigrateGroups. The new index doubles in size unless
+//                most of the used slots are tombstones
+// PARAMETERS   : HashShard* shard : Shard of the hash table to resize (its lock must be held)
+// RETURNS      : void
+//
+void ResizeHashTable(HashShard* shard) {
+    // Finish any resize still in progress before starting a new one
+    if (shard->Old.Control != NULL) {
+        MigrateGroups(shard, shard->Old.Capacity);
+    }
+
+    unsigned int capacity = shard->Current.Capacity;
+    if (shard->Current.Count * 100 >= capacity * HASH_MAX_LOAD / 2) {
+        capacity = capacity * 2;
+    }
+
+    shard->Old = shard->Current;
+    shard->MigrateIndex = 0;
+    InitializeHashIndex(&shard->Current, capacity);
+}
+
+//
+// FUNCTION     : MigrateGroups
+// DESCRIPTION  : Moves the KVPs of up to the given number of groups from the old index into the current index.
+//                Moved slots are marked deleted so probe sequences in the old index stay intact. Once every group
+//                has been moved, the old index is freed
+// PARAMETERS   : HashShard* shard   : Shard of the hash table (its lock must be held)
+//                unsigned int steps : Maximum number of old groups to migrate
+// RETURNS      : void
+//
+void MigrateGroups(HashShard* shard, unsigned int steps) {
+    if (shard->Old.Control == NULL) {
+        return;
+    }
+
+    unsigned int groups = shard->Old.Capacity / HASH_GROUP_WIDTH;
+
+    while (steps > 0 && shard->MigrateIndex < groups) {
+        unsigned int first = shard->MigrateIndex * HASH_GROUP_WIDTH;
+        for (unsigned int slot = first; slot < first + HASH_GROUP_WIDTH; slot++) {
+            if ((shard->Old.Control[slot] & 0x80) == 0) {
+                PlaceKVP(&shard->Current, shard->Old.Slots[slot].KVP);
+                shard->Old.Control[slot] = CTRL_DELETED;
+                shard->Old.Count--;
+            }
+        }
+        shard->MigrateIndex++;
+        steps--;
+    }
+
+    // Free old index once migration is complete
+    if (shard->MigrateIndex >= groups) {
+        FreeHashIndex(&shard->Old);
+        shard->MigrateIndex = 0;
+    }
+}
+
 //
 // FUNCTION     : InitializeKeyValuePair
 // DESCRIPTION  : Dynamically allocates memory for KVP & calls new struct
-// PARAMETERS   : Citation* newCitation : Citation node to be stored as value
+// PARAMETERS   : Citation* newCitation     : Citation node to be stored as value
+//                unsigned long long hash   : Hash of the citation URL
 // RETURNS      : CitationKVP*
 //
-CitationKVP* InitializeKeyValuePair(Citation* newCitation) {
-    CitationKVP* kvp = (CitationKVP*)malloc(sizeof(CitationKVP));
+CitationKVP* InitializeKeyValuePair(Citation* newCitation, unsigned long long hash) {
+    CitationKVP* kvp = (CitationKVP*)AllocateNode(POOL_KVP);
 
     if (kvp == NULL) {
         printf("Insufficient memory to create key-value pair. Exiting program...\n");
@@ -73,16 +405,18 @@ CitationKVP* InitializeKeyValuePair(Citation* newCitation) {
     }
 
     // Store values in key-value pair
-    kvp->URL = _strdup(newCitation->URL); // Key: citation URL
+    kvp->URL = URLKey(GetCitationURL(newCitation)); // Key: citation URL (shares the interned string)
     kvp->Citation = newCitation; // Value
-    kvp->NextKeyValuePair = NULL;
+    kvp->Hash = hash;
 
     return kvp;
 }
 
 //
 // FUNCTION     : InsertHashTable
-// DESCRIPTION  : Hashes a given URL and creates a KVP pair and store in the hash table - returns true if successful
+// DESCRIPTION  : Hashes a given URL and creates a KVP pair and store in the hash table - returns true if successful.
+//                Safe to call from several threads at once: the duplicate check, insert and indexing hold the shard
+//                lock, so a citation another thread can find is already in the secondary indexes
 // PARAMETERS   : CitationManager* Citations : Hash table containing citations
 //                Citation* newCitation      : Citation node to be stored in hash table
 // RETURNS      : bool
@@ -99,46 +433,56 @@ bool InsertHashTable(CitationManager* Citations, Citation* newCitation) {
     }
 
     // Check for non-empty URL data
-    if (strlen(newCitation->URL) == 0) {
+    if (strlen(GetCitationURL(newCitation)) == 0) {
         printf("Error: URL in citation is empty.\n");
         return false;
     }
 
-    // Hash the key (website URL)
-    int hash = Hash(newCitation->URL);
-
-    // Create key-value pair
-    CitationKVP* newKVP = InitializeKeyValuePair(newCitation);
-
-    // Insert directly if bucket is empty
-    if (Citations->Table[hash] == NULL) {
-        Citations->Table[hash] = newKVP;
-        return true;
-    }
+    // Hash the key (website URL without scheme)
+    return InsertHashTableWithHash(Citations, newCitation, HashKey(Citations, URLKey(GetCitationURL(newCitation))));
+}
 
-    // Do not insert if URL already exists in hash table
-    if (strcmp(Citations->Table[hash]->URL, newCitation->URL) == 0) {
-        printf("Error: URL already stored in data.\n");
-        free(newKVP);
-        return false;
-    }
+//
+// FUNCTION     : InsertHashTableWithHash
+// DESCRIPTION  : Inserts a citation whose key has already been hashed with HashKey - returns true if successful
+// PARAMETERS   : CitationManager* Citations : Hash table containing citations
+//                Citation* newCitation      : Citation node to be stored in hash table
+//                unsigned long long hash    : Hash of the citation key
+// RETURNS      : bool
+//
+bool InsertHashTableWithHash(CitationManager* Citations, Citation* newCitation, unsigned long long hash) {
+    const char* key = URLKey(GetCitationURL(newCitation));
+    HashShard* shard = ShardFor(Citations, hash);
+    CitationKVP* newKVP = InitializeKeyValuePair(newCitation, hash);
+    bool inserted = false;
+
+    {
+        std::lock_guard<std::mutex> guard(*shard->Lock);
+
+        // Move part of the old index over if a resize is in progress
+        MigrateGroups(shard, REHASH_STEP);
+
+        // Do not insert if URL already exists in hash table
+        if (FindKVP(shard, hash, key) == NULL) {
+            // Grow (or clean out tombstones) before the index passes the maximum load factor
+            HashIndex* index = &shard->Current;
+            if ((index->Count + index->Tombstones + 1) * 100 > index->Capacity * HASH_MAX_LOAD) {
+                ResizeHashTable(shard);
+            }
 
-    // Insert with separate chaining if there is collision
-    CitationKVP* current = (Citations)->Table[hash];
-    while (current->NextKeyValuePair != NULL) {
-        current = current->NextKeyValuePair;
+            // Insert key-value pair and add the citation to the secondary indexes before the shard is unlocked
+            PlaceKVP(&shard->Current, newKVP);
+            IndexCitation(&Citations->Indexes, newCitation);
+            inserted = true;
+        }
     }
 
-    // Do not insert if URL already exists in hash table
-    if (strcmp(current->URL, newCitation->URL) == 0) {
-        printf("Error: URL already stored in data.\n");
-        free(newKVP);
-        return false;
+    if (!inserted) {
+        fprintf(stderr, "Error: URL already stored in data.\n");
+        FreeNode(POOL_KVP, newKVP);
     }
 
-    // Insert into hash table
-    current->NextKeyValuePair = newKVP;
-    return true;
+    return inserted;
 }
 
 //
@@ -149,68 +493,99 @@ bool InsertHashTable(CitationManager* Citations, Citation* newCitation) {
 // RETURNS      : Citation*
 //
 Citation* SearchHashTable(CitationManager* Citations, const char* url) {
-    int hash = Hash(url);
-    Citation* nullCitation = NULL; // Return null if not found
-
-    // Search if bucket is not empty
-    if (Citations->Table[hash] != NULL) {
-        CitationKVP* current = Citations->Table[hash];
+    CitationKVP* kvp = SearchKVPHashTable(Citations, url);
 
-        // If there is only one citation stored in the bucket, check if the URL matches, and return
-        if (current->NextKeyValuePair == NULL && strncmp(current->Citation->URL, url, LINE_SIZE) == 0) {
-            return current->Citation;
-        }
-
-        // If there is more than one citation stored in the bucket, iterate until there is a match
-        while (current != NULL) {
-            if (strncmp(current->Citation->URL, url, LINE_SIZE) == 0) {
-                return current->Citation;
-            }
-            current = current->NextKeyValuePair;
-        }
+    // Return null if not found
+    if (kvp == NULL) {
+        return NULL;
     }
 
-    // If bucket is empty, return NULL
-    return nullCitation;
+    return kvp->Citation;
 }
 
 //
 // FUNCTION     : SearchKVPHashTable
-// DESCRIPTION  : Searches hash table wih URL and returns the KVP
+// DESCRIPTION  : Searches hash table wih URL and returns the KVP. The URL is canonicalized first, so any form of a
+//                stored URL (e.g. different host case or tracking parameters) finds the citation
 // PARAMETERS   : CitationManager* Citations : Hash table containing citations
 //                const char* url            : The website URL to search for citation
 // RETURNS      : CitationKVP*
 //
 CitationKVP* SearchKVPHashTable(CitationManager* Citations, const char* url) {
-    int hash = Hash(url);
-    CitationKVP* nullKVP = NULL; // Return null if not found
+    size_t length = strlen(url);
+    char stackBuffer[LINE_SIZE];
+    char* canonical = length < LINE_SIZE ? stackBuffer : (char*)malloc(length + 1);
+    if (canonical == NULL) {
+        printf("Insufficient memory to search hash table. Exiting program...\n");
+        exit(EXIT_FAILURE);
+    }
+    canonicalizeURL(url, length, canonical);
 
-    // Search if bucket is not empty
-    if (Citations->Table[hash] != NULL) {
-        CitationKVP* current = Citations->Table[hash];
+    const char* key = URLKey(canonical);
+    CitationKVP* kvp = SearchKeyHashTable(Citations, key, HashKey(Citations, key));
 
-        // If there is only one citation stored in the bucket, check if the URL matches, and return
-        if (current->NextKeyValuePair == NULL && strncmp(current->Citation->URL, url, LINE_SIZE) == 0) {
-            return current;
-        }
+    if (canonical != stackBuffer) {
+        free(canonical);
+    }
+    return kvp;
+}
 
-        // If there is more than one citation stored in the bucket, iterate until there is a match
-        while (current != NULL) {
-            if (strncmp(current->Citation->URL, url, LINE_SIZE) == 0) {
-                return current;
-            }
-            current = current->NextKeyValuePair;
+//
+// FUNCTION     : HashKey
+// DESCRIPTION  : Hashes a key (see URLKey) with the hash function of the hash table
+// PARAMETERS   : CitationManager* Citations : Hash table containing citations
+//                const char* key            : Key of a canonical URL
+// RETURNS      : unsigned long long
+//
+unsigned long long HashKey(CitationManager* Citations, const char* key) {
+    return Citations->HashURL(key, strlen(key));
+}
+
+//
+// FUNCTION     : SearchKeyHashTable
+// DESCRIPTION  : Searches hash table for a key that has already been canonicalized and hashed, so a caller that
+//                needs the hash again (e.g. to insert) only computes it once
+// PARAMETERS   : CitationManager* Citations : Hash table containing citations
+//                const char* key            : Key of a canonical URL (see URLKey)
+//                unsigned long long hash    : Hash of the key from HashKey
+// RETURNS      : CitationKVP*
+//
+CitationKVP* SearchKeyHashTable(CitationManager* Citations, const char* key, unsigned long long hash) {
+    HashShard* shard = ShardFor(Citations, hash);
+    std::lock_guard<std::mutex> guard(*shard->Lock);
+    return FindKVP(shard, hash, key);
+}
+
+//
+// FUNCTION     : FindKVP
+// DESCRIPTION  : Searches the current index, and the old index if a resize is in progress, for an already hashed URL
+// PARAMETERS   : HashShard* shard           : Shard that stores the hash (its lock must be held)
+//                unsigned long long hash    : Hash of the key
+//                const char* key            : Key of the canonical URL to search for (see URLKey)
+// RETURNS      : CitationKVP*
+//
+static CitationKVP* FindKVP(HashShard* shard, unsigned long long hash, const char* key) {
+    // Search current index
+    unsigned int slot = FindSlot(&shard->Current, hash, key);
+    if (slot < shard->Current.Capacity) {
+        return shard->Current.Slots[slot].KVP;
+    }
+
+    // Search old index if a resize is in progress
+    if (shard->Old.Control != NULL) {
+        slot = FindSlot(&shard->Old, hash, key);
+        if (slot < shard->Old.Capacity) {
+            return shard->Old.Slots[slot].KVP;
         }
     }
 
-    // If bucket is empty, return NULL
-    return nullKVP;
+    // If URL is not stored, return NULL
+    return NULL;
 }
 
 //
 // FUNCTION     : DeleteHashTable
-// DESCRIPTION  : Deletes a key-value pair from the table. If there is more than one key-value pair stored in a
-//                bucket, 
+// DESCRIPTION  : Deletes a key-value pair from the table by marking its slot as deleted
 // PARAMETERS   : CitationManager* Citations    : Hash table containing citations
 //                CitationKVP* toDelete         : Citation node to be deleted in hash table
 // RETURNS      : bool
@@ -226,73 +601,54 @@ bool DeleteHashTable(CitationManager* Citations, CitationKVP* toDelete) {
         return false;
     }
 
-    // Hash the key (website URL)
-    int hash = Hash(toDelete->URL);
+    HashShard* shard = ShardFor(Citations, toDelete->Hash);
+    {
+        std::lock_guard<std::mutex> guard(*shard->Lock);
 
-    // Store KVP to free
-    CitationKVP* toFree = NULL;
-    CitationKVP* current = Citations->Table[hash];
-
-    // Check if there are other KVPs are stored in the same bucket
-    if (Citations->Table[hash]->NextKeyValuePair != NULL) {
-        // Check first item
-        if (strcmp(current->Citation->URL, toDelete->URL) == 0) {
-            toFree = current;
-            Citations->Table[hash] = current->NextKeyValuePair;
+        // Find the slot holding the KVP in the current or old index
+        HashIndex* index = &shard->Current;
+        unsigned int slot = FindKVPSlot(index, toDelete);
+        if (slot >= index->Capacity && shard->Old.Control != NULL) {
+            index = &shard->Old;
+            slot = FindKVPSlot(index, toDelete);
         }
-        // Iterate through linked list
-        else
-        {
-            while (current->NextKeyValuePair != NULL) {
-                // If next node matches, move current node to next node's next
-                if (strcmp(current->NextKeyValuePair->Citation->URL, toDelete->URL) == 0) {
-                    toFree = current->NextKeyValuePair;
-                    current->NextKeyValuePair = current->NextKeyValuePair->NextKeyValuePair;
-                    break;
-                }
-                current = current->NextKeyValuePair;
-            }
+
+        if (slot >= index->Capacity) {
+            return false;
         }
-    }
-    else {
-        toFree = current;
-        Citations->Table[hash] = NULL;
-    }
 
-    // Free memory
-    if (toFree != NULL) {
-        free(toFree);
-        return true;
+        // Leave a tombstone so later slots in the probe sequence can still be found
+        index->Control[slot] = CTRL_DELETED;
+        index->Count--;
+        index->Tombstones++;
+
+        // Remove from secondary indexes while the shard is locked, so the indexes always match the table
+        UnindexCitation(&Citations->Indexes, toDelete->Citation);
     }
 
-    return false;
+    // Free memory (the URL belongs to the URL pool)
+    FreeNode(POOL_KVP, toDelete);
+
+    return true;
 }
 
 //
 // FUNCTION     : FreeHashTable
-// DESCRIPTION  : Frees dynamically allocated memory in hash table
+// DESCRIPTION  : Frees dynamically allocated memory in hash table. The KVPs and citations are not visited - they are
+//                freed all at once with the node pools (see freeMemory)
 // PARAMETERS   : CitationManager* Citations : Hash table containing citations
 // RETURNS      : void
 //
 void FreeHashTable(CitationManager* Citations) {
-    // Iterate through every bucket and free memory of KVP
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        if (Citations->Table[i] != NULL) {
-            // If bucket has only one item, free memory
-            if (Citations->Table[i]->NextKeyValuePair == NULL) {
-                free(Citations->Table[i]);
-            }
-            // Otherwise iterate through linked list to free all memory
-            else {
-                CitationKVP* current = Citations->Table[i];
-                CitationKVP* next = NULL;
-                while (current != NULL) {
-                    next = current->NextKeyValuePair;
-                    free(current);
-                    current = next;
-                }
-            }
+    // Free the current index and any index still being migrated of every shard
+    for (int i = 0; i < HASH_SHARDS; i++) {
+        HashShard* shard = &Citations->Shards[i];
+        FreeHashIndex(&shard->Current);
+        if (shard->Old.Control != NULL) {
+            FreeHashIndex(&shard->Old);
         }
+        delete shard->Lock;
     }
-    printf("Hash table was completely freed.\n");
+    FreeIndexes(&Citations->Indexes);
+    free(Citations);
 }
\ No newline at end of file
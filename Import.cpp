@@ -7,6 +7,25 @@
 */
 
 #include "Citations.h"
+#include "WebScraping.h"
+
+// Define constants
+#define STREAM_SET_SIZE	1024	// Initial number of slots in the set of streamed URLs (must be a power of 2)
+
+// Define set of URLs written by streamCitations
+// Holds the 64-bit hash of each URL key with linear probing. Two different URLs with the same 64-bit hash are
+// unlikely enough (see the collisions printed by hashReport) that the second is treated as a duplicate
+typedef struct StreamedKeys {
+	unsigned long long* Hashes; // 0 for an empty slot
+	unsigned int Capacity;
+	unsigned int Count;
+} StreamedKeys;
+
+// Define hash of a URL list entry (for finding repeated URLs)
+typedef struct ListHash {
+	unsigned long long Hash;
+	int Index;
+} ListHash;
 
 //
 // FUNCTION     : LoadFile
@@ -36,9 +55,9 @@ FILE* LoadFile(void) {
 		}
 	}
 
-	// Open file for reading safely
+	// Open file for reading safely (in binary mode - line endings are handled by the import)
 	errno_t err;
-	err = fopen_s(&file, filename, "r+");
+	err = fopen_s(&file, filename, "rb");
 
 	// Print message if there is failure to open file
 	if (err != 0) {
@@ -51,6 +70,8 @@ FILE* LoadFile(void) {
 //
 // FUNCTION     : StoreFileData
 // DESCRIPTION  : Reads URLs from a file and stores them as citation nodes in hash table & queue of citations to process
+//				  using the import engine (see ImportURLFile). A BibLaTeX file is merged into the library instead
+//				  (see StoreBibData). Files compressed with gzip or zstd are decompressed as they are read
 // PARAMETERS   : FILE* file				 :	Pointer to file containing website URLs
 //				  CitationManager* Citations : Hash table containing citations
 //				  Queue* CitationsToProcess	 : Queue to store citations that need to be processed
@@ -63,83 +84,96 @@ void StoreFileData(FILE* file, CitationManager* Citations, Queue* CitationsToPro
 		return;
 	}
 
-	char buffer[LINE_SIZE] = ""; // String to store line from file
-	char* readLine; // String to store line to add to node
-	int count = 0; // Count how many citations were added
-
-	while (fgets(buffer, LINE_SIZE, file) != NULL && count <= 100) {
-		// Stop reading file if some file error occurs
-		if (ferror(file)) {
-			printf("Error reading file.\n");
-			return;
-		}
-		// Read from file
-		else
-		{
-			clearNewLineChar(buffer);
-			readLine = trimWhitespace(buffer);
-			// Validate input from file - read valid URLs
-			if (std::regex_match(buffer, std::regex("^https?:\\/\\/[A-za-z\\.0-9\\/_\\-\\:\\#\\[\\]\\@\\!\\$\\&\\'\\(\\)\\*\\+\\,\\;\\%\\=\\?]+")) == true) {
-				strncpy(readLine, buffer, LINE_SIZE);
-				// Add data to data structures
-				InsertData(Citations, CitationsToProcess, readLine);
-				// Increment citation count
-				if (count < 100) {
-					count++;
-				}
-			}
-		}
+	// Decompress gzip and zstd files while they are imported
+	file = openImportStream(file);
+	if (isBibFile(file)) {
+		StoreBibData(file, Citations, CitationsToProcess);
+	}
+	else {
+		ImportURLFile(file, Citations, CitationsToProcess);
 	}
 
 	// Close the file safely
-	if (fclose(file) != 0) {
+	if (closeImportStream(file) != 0) {
 		printf("Error closing file.\n");
 		return;
 	}
+}
 
-	// Print that data has been stored
-	if (count > 0) {
-		printf("%d citations loaded from file.\n", count);
+//
+// FUNCTION     : InsertData
+// DESCRIPTION  : Initializes a citation node for a URL and inserts it into hash table & enqueues it for processesing.
+//				  The URL is looked up in the hash table first, so a URL that is already stored costs one hash and
+//				  no memory allocation - returns true if the citation was added
+// PARAMETERS   : CitationManager* Citations : Hash table containing citations
+//				  Queue* CitationsToProcess: Queue to store citations that need to be processed
+//				  const char* url : URL of website to be stored
+//				  size_t length : Length of url (URLs of any length are stored)
+// RETURNS      : bool
+//
+bool InsertData(CitationManager* Citations, Queue* CitationsToProcess, const char* url, size_t length) {
+	// Canonicalize and hash the URL once
+	char stackBuffer[LINE_SIZE];
+	char* canonical = length < LINE_SIZE ? stackBuffer : (char*)malloc(length + 1);
+	if (canonical == NULL) {
+		printf("Insufficient memory to store URL. Exiting program...\n");
+		exit(EXIT_FAILURE);
 	}
-	else if (count == 0) {
-		printf("No data loaded from file.\n");
+	canonicalizeURL(url, length, canonical);
+	bool added = InsertCanonicalData(Citations, CitationsToProcess, canonical, HashKey(Citations, URLKey(canonical)));
+
+	if (canonical != stackBuffer) {
+		free(canonical);
 	}
+	return added;
 }
 
 //
-// FUNCTION     : InsertData
-// DESCRIPTION  : Initializes a citation node for a URL and inserts it into hash table & enqueues it for processesing
+// FUNCTION     : InsertCanonicalData
+// DESCRIPTION  : Stores a URL that has already been canonicalized and hashed like InsertData (used by imports that
+//				  canonicalize URLs ahead of time) - returns true if the citation was added
 // PARAMETERS   : CitationManager* Citations : Hash table containing citations
 //				  Queue* CitationsToProcess: Queue to store citations that need to be processed
-//				  const char* url : URL of website to be stored
-// RETURNS      : void
+//				  const char* canonical : Canonical URL of website to be stored (see canonicalizeURL)
+//				  unsigned long long hash : Hash of the URL's key (see HashKey)
+// RETURNS      : bool
 //
-void InsertData(CitationManager* Citations, Queue* CitationsToProcess, const char* url) {
+bool InsertCanonicalData(CitationManager* Citations, Queue* CitationsToProcess, const char* canonical, unsigned long long hash) {
+	// Skip URLs that are already stored
+	if (SearchKeyHashTable(Citations, URLKey(canonical), hash) != NULL) {
+		return false;
+	}
+
 	// Create citation node with URL
-	Citation* newCitation = InitializeCitation(url);
+	Citation* newCitation = InitializeCitation(canonical);
 
 	// Add citation to hash table and queue of citations to process
-	if (InsertHashTable(Citations, newCitation)) {
+	if (InsertHashTableWithHash(Citations, newCitation, hash)) {
 		Enqueue(CitationsToProcess, newCitation);
+		return true;
 	}
 	// If insertion into hash table is not successful, free citation node
 	else {
-		free(newCitation);
+		FreeCitation(newCitation);
+		return false;
 	}
 }
 
 //
 // FUNCTION     : importCitationsFile
-// DESCRIPTION  : Opens a file given a filename & stores data to queue
+// DESCRIPTION  : Opens a file given a filename & stores data to hash table & queue, validating the URLs on every
+//				  processor (see ImportURLFile), or merging the entries of a BibLaTeX file (see StoreBibData). Files
+//				  compressed with gzip or zstd are decompressed as they are read
 // PARAMETERS   : FILE* file				: Pointer to file containing website URLs
+//				  CitationManager* Citations : Hash table containing citations
 //				  Queue* CitationsToProcess	: Queue to store citations that need to be processed
 //				  const char* url			: URL of website to be stored
 // RETURNS      : void
 //
-void importCitationsFile(FILE* ImportFile, Queue* CitationsToProcess, const char* filename) {
-	// Open file for reading safely
+void importCitationsFile(FILE* ImportFile, CitationManager* Citations, Queue* CitationsToProcess, const char* filename) {
+	// Open file for reading safely (in binary mode - line endings are handled by the import)
 	errno_t err;
-	err = fopen_s(&ImportFile, filename, "r+");
+	err = fopen_s(&ImportFile, filename, "rb");
 
 	// Print message if there is failure to open file
 	if (err != 0) {
@@ -147,36 +181,274 @@ void importCitationsFile(FILE* ImportFile, Queue* CitationsToProcess, const char
 		exit(EXIT_FAILURE);
 	}
 
-	char buffer[LINE_SIZE] = ""; // String to store line from file
-	char* readLine; // String to store line to add to node
-
-	// Initialize new citation node to add for each URL
-	Citation* newCitation;
-
-	while (fgets(buffer, LINE_SIZE, ImportFile) != NULL) {
-		// Stop reading file if some file error occurs
-		if (ferror(ImportFile)) {
-			printf("Error reading file.\n");
-			return;
-		}
-		// Read from file
-		else
-		{
-			clearNewLineChar(buffer);
-			readLine = trimWhitespace(buffer);
-			// Validate input from file - read valid URLs
-			if (std::regex_match(buffer, std::regex("^https?:\\/\\/[A-za-z\\.0-9\\/_\\-\\:\\#\\[\\]\\@\\!\\$\\&\\'\\(\\)\\*\\+\\,\\;\\%\\=]+")) == true) {
-				strncpy(readLine, buffer, LINE_SIZE);
-				// Add data to queue
-				newCitation = InitializeCitation(readLine);
-				Enqueue(CitationsToProcess, newCitation);
-			}
-		}
+	// Decompress gzip and zstd files while they are imported
+	ImportFile = openImportStream(ImportFile);
+	if (isBibFile(ImportFile)) {
+		StoreBibData(ImportFile, Citations, CitationsToProcess);
+	}
+	else {
+		ImportURLFile(ImportFile, Citations, CitationsToProcess);
 	}
 
 	// Close the file safely
-	if (fclose(ImportFile) != 0) {
+	if (closeImportStream(ImportFile) != 0) {
 		printf("Error closing file.\n");
 		return;
 	}
+}
+
+//
+// FUNCTION     : AddStreamedKey
+// DESCRIPTION  : Adds the hash of a URL key to the set of URLs already streamed - returns false if it was already in
+//				  the set. Only the 64-bit hash is kept, so the set takes 8 bytes per slot however long the URLs are
+// PARAMETERS   : StreamedKeys* keys		: Set of streamed URLs
+//				  unsigned long long hash	: Hash of the URL's key
+// RETURNS      : bool
+//
+static bool AddStreamedKey(StreamedKeys* keys, unsigned long long hash) {
+	// 0 marks an empty slot
+	if (hash == 0) {
+		hash = 1;
+	}
+
+	// Keep the set at most half full
+	if ((keys->Count + 1) * 2 > keys->Capacity) {
+		unsigned int oldCapacity = keys->Capacity;
+		unsigned long long* oldHashes = keys->Hashes;
+		keys->Capacity = oldCapacity == 0 ? STREAM_SET_SIZE : oldCapacity * 2;
+		keys->Hashes = (unsigned long long*)calloc(keys->Capacity, sizeof(unsigned long long));
+		if (keys->Hashes == NULL) {
+			fprintf(stderr, "Insufficient memory to store URL. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		for (unsigned int i = 0; i < oldCapacity; i++) {
+			if (oldHashes[i] != 0) {
+				unsigned int slot = (unsigned int)oldHashes[i] & (keys->Capacity - 1);
+				while (keys->Hashes[slot] != 0) {
+					slot = (slot + 1) & (keys->Capacity - 1);
+				}
+				keys->Hashes[slot] = oldHashes[i];
+			}
+		}
+		free(oldHashes);
+	}
+
+	unsigned int slot = (unsigned int)hash & (keys->Capacity - 1);
+	while (keys->Hashes[slot] != 0) {
+		if (keys->Hashes[slot] == hash) {
+			return false;
+		}
+		slot = (slot + 1) & (keys->Capacity - 1);
+	}
+	keys->Hashes[slot] = hash;
+	keys->Count++;
+	return true;
+}
+
+//
+// FUNCTION     : streamCitations
+// DESCRIPTION  : Reads URLs from a file or pipe and writes each new citation as soon as its line is read (after
+//				  scraping it from the web if asked), so the output starts before the input ends. Output is flushed
+//				  whenever the import waits for more input. Each citation is freed once it is written and is never
+//				  stored in the library - only the hash of each URL key is kept to skip duplicate URLs, so memory
+//				  grows by a few bytes per URL. Messages are printed to standard error, keeping standard output free
+//				  for the citations
+// PARAMETERS   : FILE* ImportFile				: File or pipe containing website URLs (not closed)
+//				  FILE* ExportFile				: File or pipe to write the citations to (not closed)
+//				  bool webScrape				: true to scrape the data of each citation from its website
+// RETURNS      : void
+//
+void streamCitations(FILE* ImportFile, FILE* ExportFile, bool webScrape) {
+	LineReader reader; // Reads the input as it arrives
+	LineView line; // Line of the input inside the reader's block
+	StreamedKeys keys = { NULL, 0, 0 }; // Hashes of the URLs already written
+	char* canonical = NULL; // Canonical URL of the current line
+	size_t canonicalSize = 0; // Size of canonical
+	int count = 0; // Count how many citations were written
+	int duplicates = 0; // Count how many URLs were already written
+	SetAccessDate(currentDate()); // Every citation of the input is accessed today
+
+	BibWriter writer; // Collects the citations until the import waits for more input
+	InitializeLineReader(&reader, ImportFile);
+	InitializeBibWriter(&writer, ExportFile);
+	reader.Flush = &writer;
+	while (ReadLine(&reader, &line)) {
+		trimLine(&line);
+		if (!isValidURL(line.Text, line.Length)) {
+			continue;
+		}
+
+		// Canonicalize the URL (never longer than the line) and skip it if it was already written
+		if (line.Length + 1 > canonicalSize) {
+			canonicalSize = line.Length + 1 > LINE_SIZE ? line.Length + 1 : LINE_SIZE;
+			free(canonical);
+			canonical = (char*)malloc(canonicalSize);
+			if (canonical == NULL) {
+				fprintf(stderr, "Insufficient memory to store URL. Exiting program...\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		canonicalizeURL(line.Text, line.Length, canonical);
+		const char* key = URLKey(canonical);
+		if (!AddStreamedKey(&keys, HashFast(key, strlen(key)))) {
+			duplicates++;
+			continue;
+		}
+
+		// Write the citation and free it straight away
+		Citation* current = InitializeCitationWithURL(canonical);
+		if (webScrape) {
+			WebScraping(current);
+		}
+		writeCitation(&writer, current, count);
+		FreeCitation(current);
+		count++;
+	}
+
+	bool error = reader.Error;
+	FreeLineReader(&reader);
+	free(canonical);
+	free(keys.Hashes);
+	if (error) {
+		fprintf(stderr, "Error reading file.\n");
+	}
+	if (!FreeBibWriter(&writer)) {
+		fprintf(stderr, "Error writing file.\n");
+	}
+
+	fprintf(stderr, "%d citations written.\n", count);
+	if (duplicates > 0) {
+		fprintf(stderr, "%d URLs were already written and skipped.\n", duplicates);
+	}
+}
+
+//
+// FUNCTION     : CompareListHashes
+// DESCRIPTION  : qsort comparison function to order the hashes of a URL list
+// PARAMETERS   : const void* a : First ListHash
+//				  const void* b : Second ListHash
+// RETURNS      : int
+//
+static int CompareListHashes(const void* a, const void* b) {
+	unsigned long long hashA = ((const ListHash*)a)->Hash;
+	unsigned long long hashB = ((const ListHash*)b)->Hash;
+	return (hashA > hashB) - (hashA < hashB);
+}
+
+//
+// FUNCTION     : ReadURLList
+// DESCRIPTION  : Reads a file of URLs (of any length, compressed or not) into a URL list. Each valid URL is
+//				  canonicalized the way the import would store it, and a URL that was already read is only stored once,
+//				  since the hash table never holds the same URL twice
+// PARAMETERS   : FILE* file		: File opened in binary mode (closed by this function)
+//				  URLList* list		: Stores the URLs (free with FreeURLList)
+// RETURNS      : void
+//
+void ReadURLList(FILE* file, URLList* list) {
+	LineReader reader;
+	LineView line;
+	memset(list, 0, sizeof(URLList));
+
+	file = openImportStream(file);
+	InitializeLineReader(&reader, file);
+	while (ReadLine(&reader, &line)) {
+		trimLine(&line);
+		if (!isValidURL(line.Text, line.Length)) {
+			continue;
+		}
+
+		// Grow the buffers (the canonical URL is never longer than the line)
+		if (list->Length + line.Length + 1 > list->TextCapacity) {
+			while (list->Length + line.Length + 1 > list->TextCapacity) {
+				list->TextCapacity = list->TextCapacity == 0 ? READ_BLOCK_SIZE : list->TextCapacity * 2;
+			}
+			list->Text = (char*)realloc(list->Text, list->TextCapacity);
+		}
+		if (list->Count == list->Capacity) {
+			list->Capacity = list->Capacity == 0 ? 1024 : list->Capacity * 2;
+			list->URLs = (size_t*)realloc(list->URLs, list->Capacity * sizeof(size_t));
+			list->Keys = (size_t*)realloc(list->Keys, list->Capacity * sizeof(size_t));
+			list->KeyLengths = (size_t*)realloc(list->KeyLengths, list->Capacity * sizeof(size_t));
+		}
+		if (list->Text == NULL || list->URLs == NULL || list->Keys == NULL || list->KeyLengths == NULL) {
+			printf("Insufficient memory to read file. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+
+		char* canonical = list->Text + list->Length;
+		size_t length = canonicalizeURL(line.Text, line.Length, canonical);
+		const char* key = URLKey(canonical);
+		list->URLs[list->Count] = list->Length;
+		list->Keys[list->Count] = key - list->Text;
+		list->KeyLengths[list->Count] = length - (key - canonical);
+		list->Length += length + 1;
+		list->Count++;
+	}
+
+	if (reader.Error) {
+		printf("Error reading file.\n");
+	}
+	FreeLineReader(&reader);
+	closeImportStream(file);
+	list->Read = list->Count;
+	if (list->Count == 0) {
+		return;
+	}
+
+	// Find repeated keys by sorting their hashes, then drop them (keeping the first in file order)
+	ListHash* hashes = (ListHash*)malloc(list->Count * sizeof(ListHash));
+	bool* repeated = (bool*)calloc(list->Count, sizeof(bool));
+	if (hashes == NULL || repeated == NULL) {
+		printf("Insufficient memory to read file. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < list->Count; i++) {
+		hashes[i].Hash = HashFast(list->Text + list->Keys[i], list->KeyLengths[i]);
+		hashes[i].Index = i;
+	}
+	qsort(hashes, list->Count, sizeof(ListHash), CompareListHashes);
+	for (int run = 0; run < list->Count; ) {
+		int end = run + 1;
+		while (end < list->Count && hashes[end].Hash == hashes[run].Hash) {
+			end++;
+		}
+		for (int a = run; a < end; a++) {
+			for (int b = a + 1; b < end; b++) {
+				int first = hashes[a].Index < hashes[b].Index ? hashes[a].Index : hashes[b].Index;
+				int second = hashes[a].Index < hashes[b].Index ? hashes[b].Index : hashes[a].Index;
+				if (strcmp(list->Text + list->Keys[first], list->Text + list->Keys[second]) == 0) {
+					repeated[second] = true;
+				}
+			}
+		}
+		run = end;
+	}
+
+	int unique = 0;
+	for (int i = 0; i < list->Count; i++) {
+		if (!repeated[i]) {
+			list->URLs[unique] = list->URLs[i];
+			list->Keys[unique] = list->Keys[i];
+			list->KeyLengths[unique] = list->KeyLengths[i];
+			unique++;
+		}
+	}
+	list->Count = unique;
+
+	free(hashes);
+	free(repeated);
+}
+
+//
+// FUNCTION     : FreeURLList
+// DESCRIPTION  : Frees the URLs of a URL list
+// PARAMETERS   : URLList* list : List to free
+// RETURNS      : void
+//
+void FreeURLList(URLList* list) {
+	free(list->Text);
+	free(list->URLs);
+	free(list->Keys);
+	free(list->KeyLengths);
+	memset(list, 0, sizeof(URLList));
 }
\ No newline at end of file
@@ -0,0 +1,414 @@
+/*
+* FILE          : ImportPipeline.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the multi-threaded import engine used by every file import (from the menu or
+*                 the command line). The file is read in chunks that end on a line boundary, a pool of worker threads
+*                 validates, canonicalizes and hashes the URLs of each chunk, and the chunks are added to the library in
+*                 file order, so the queue is the same as a single-threaded import
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "Citations.h"
+
+// Define constants
+#define IMPORT_CHUNK_SIZE	(4 << 20)	// Bytes of the file read into each chunk
+#define IMPORT_MAX_THREADS	64			// Largest number of worker threads
+#define IMPORT_PROGRESS_SECONDS	1.0		// Seconds between progress reports of a long import
+
+// Number of worker threads used to import (0 uses one per processor)
+static int ImportThreads = 0;
+
+// Define Imported URL
+typedef struct ImportURL {
+	size_t Offset; // Start of the canonical URL in the chunk's URLs
+	unsigned long long Hash; // Hash of the URL's key (see HashKey)
+} ImportURL;
+
+// Define Import Chunk
+// Whole lines of the file, and the canonical URLs found in them once a worker has processed the chunk
+typedef struct ImportChunk {
+	char* Text; // Lines of the chunk
+	size_t Length;
+	char* URLs; // Canonical URLs, each null-terminated
+	ImportURL* Items;
+	int Count;
+	int Lines;
+	int Invalid; // Lines that are not blank and not valid URLs
+	double Seconds; // Time a worker spent on the chunk
+	bool Done;
+} ImportChunk;
+
+// Define Import Pipeline
+// Chunks are read into a window of slots. Chunk n is in slot n % Slots until it has been added to the library
+typedef struct ImportPipeline {
+	CitationManager* Citations;
+	ImportChunk** Window;
+	int Slots;
+	long long NextRead; // Chunks read so far
+	long long NextWork; // Chunks taken by a worker so far
+	bool Stop;
+	std::mutex Lock; // Held while the window or counters are changed
+	std::condition_variable WorkReady; // Signalled when a chunk is read or the pipeline stops
+	std::condition_variable ChunkDone; // Signalled when a worker finishes a chunk
+} ImportPipeline;
+
+//
+// FUNCTION     : ReadChunk
+// DESCRIPTION  : Reads the next chunk of a file, ending after its last complete line. The partial line after it is
+//                kept in carry and starts the next chunk. A line longer than a chunk makes the chunk grow
+// PARAMETERS   : FILE* file          : File to read
+//                char** carry        : Partial line left from the last chunk (may be reallocated)
+//                size_t* carryLength : Length of the partial line
+//                bool* endOfFile     : Set once the whole file has been read
+// RETURNS      : ImportChunk*        : Chunk read, or NULL if nothing is left
+//
+static ImportChunk* ReadChunk(FILE* file, char** carry, size_t* carryLength, bool* endOfFile) {
+	size_t capacity = *carryLength + IMPORT_CHUNK_SIZE;
+	char* text = (char*)malloc(capacity);
+	if (text == NULL) {
+		printf("Insufficient memory to import file. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(text, *carry, *carryLength);
+	size_t length = *carryLength;
+	size_t scanned = *carryLength; // The partial line has no newline
+	size_t end = 0;
+
+	while (true) {
+		size_t read = fread(text + length, 1, capacity - length, file);
+		length += read;
+		if (read == 0) {
+			*endOfFile = true;
+			end = length;
+			break;
+		}
+
+		// Find the last newline in the new data
+		size_t i = length;
+		while (i > scanned && text[i - 1] != '\n') {
+			i--;
+		}
+		if (i > scanned) {
+			end = i;
+			break;
+		}
+		scanned = length;
+
+		// No complete line yet - make room for more of it
+		if (length == capacity) {
+			capacity *= 2;
+			char* grown = (char*)realloc(text, capacity);
+			if (grown == NULL) {
+				printf("Insufficient memory to import file. Exiting program...\n");
+				exit(EXIT_FAILURE);
+			}
+			text = grown;
+		}
+	}
+
+	// Keep the partial line for the next chunk
+	*carryLength = length - end;
+	char* rest = (char*)realloc(*carry, *carryLength + 1);
+	if (rest == NULL) {
+		printf("Insufficient memory to import file. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(rest, text + end, *carryLength);
+	*carry = rest;
+
+	if (end == 0) {
+		free(text);
+		return NULL;
+	}
+
+	ImportChunk* chunk = (ImportChunk*)calloc(1, sizeof(ImportChunk));
+	if (chunk == NULL) {
+		printf("Insufficient memory to import file. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	chunk->Text = text;
+	chunk->Length = end;
+	return chunk;
+}
+
+//
+// FUNCTION     : ProcessChunk
+// DESCRIPTION  : Finds the valid URLs in the lines of a chunk, and canonicalizes and hashes them (run by the workers)
+// PARAMETERS   : ImportChunk* chunk         : Chunk to process
+//                CitationManager* Citations : Hash table the URLs will be added to (only its hash function is used)
+// RETURNS      : void
+//
+static void ProcessChunk(ImportChunk* chunk, CitationManager* Citations) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Canonical URLs are never longer than their lines, so the chunk's length is enough for all of them
+	chunk->URLs = (char*)malloc(chunk->Length + 1);
+	int capacity = 1024;
+	chunk->Items = (ImportURL*)malloc(capacity * sizeof(ImportURL));
+	if (chunk->URLs == NULL || chunk->Items == NULL) {
+		printf("Insufficient memory to import file. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	size_t used = 0;
+
+	char* line = chunk->Text;
+	char* end = chunk->Text + chunk->Length;
+	while (line < end) {
+		char* newline = (char*)memchr(line, '\n', end - line);
+		char* next = newline != NULL ? newline + 1 : end;
+		size_t length = (newline != NULL ? newline : end) - line;
+		chunk->Lines++;
+
+		// Trim whitespace (including the '\r' of "\r\n")
+		while (length > 0 && isspace((unsigned char)*line)) {
+			line++;
+			length--;
+		}
+		while (length > 0 && isspace((unsigned char)line[length - 1])) {
+			length--;
+		}
+
+		if (length == 0) {
+			// Skip blank lines
+		}
+		else if (!isValidURL(line, length)) {
+			chunk->Invalid++;
+		}
+		else {
+			if (chunk->Count == capacity) {
+				capacity *= 2;
+				ImportURL* items = (ImportURL*)realloc(chunk->Items, capacity * sizeof(ImportURL));
+				if (items == NULL) {
+					printf("Insufficient memory to import file. Exiting program...\n");
+					exit(EXIT_FAILURE);
+				}
+				chunk->Items = items;
+			}
+			char* canonical = chunk->URLs + used;
+			size_t canonicalLength = canonicalizeURL(line, length, canonical);
+			chunk->Items[chunk->Count].Offset = used;
+			chunk->Items[chunk->Count].Hash = HashKey(Citations, URLKey(canonical));
+			chunk->Count++;
+			used += canonicalLength + 1;
+		}
+		line = next;
+	}
+
+	chunk->Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//
+// FUNCTION     : FreeChunk
+// DESCRIPTION  : Frees a chunk and its URLs
+// PARAMETERS   : ImportChunk* chunk : Chunk to free
+// RETURNS      : void
+//
+static void FreeChunk(ImportChunk* chunk) {
+	free(chunk->Text);
+	free(chunk->URLs);
+	free(chunk->Items);
+	free(chunk);
+}
+
+//
+// FUNCTION     : ImportWorker
+// DESCRIPTION  : Processes chunks in the order they were read until the pipeline stops
+// PARAMETERS   : ImportPipeline* pipeline : Pipeline to take chunks from
+// RETURNS      : void
+//
+static void ImportWorker(ImportPipeline* pipeline) {
+	std::unique_lock<std::mutex> guard(pipeline->Lock);
+
+	while (true) {
+		pipeline->WorkReady.wait(guard, [pipeline] { return pipeline->NextWork < pipeline->NextRead || pipeline->Stop; });
+		if (pipeline->NextWork == pipeline->NextRead) {
+			return;
+		}
+		ImportChunk* chunk = pipeline->Window[pipeline->NextWork % pipeline->Slots];
+		pipeline->NextWork++;
+
+		guard.unlock();
+		ProcessChunk(chunk, pipeline->Citations);
+		guard.lock();
+
+		chunk->Done = true;
+		pipeline->ChunkDone.notify_all();
+	}
+}
+
+//
+// FUNCTION     : SetImportThreads
+// DESCRIPTION  : Sets the number of worker threads used to validate the URLs of imported files
+// PARAMETERS   : int threads : Number of threads (0 uses one per processor)
+// RETURNS      : void
+//
+void SetImportThreads(int threads) {
+	ImportThreads = threads < 0 ? 0 : threads;
+}
+
+//
+// FUNCTION     : ImportURLFile
+// DESCRIPTION  : Imports the URLs of a file using a pool of worker threads (see SetImportThreads), and prints the
+//                throughput of each stage: reading (this thread), validating (the workers) and adding to the library
+//                (this thread). Citations are added in the order of the file, and already-stored URLs are skipped.
+//                Memory use is bounded by the chunks in flight, whatever the size of the file. Progress is reported
+//                every IMPORT_PROGRESS_SECONDS during long imports
+// PARAMETERS   : FILE* file                 : File containing website URLs (not closed)
+//                CitationManager* Citations : Hash table containing citations
+//                Queue* CitationsToProcess  : Queue to store citations that need to be processed
+// RETURNS      : bool                       : false if the file could not be read to the end
+//
+bool ImportURLFile(FILE* file, CitationManager* Citations, Queue* CitationsToProcess) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int threads = ImportThreads;
+	if (threads == 0) {
+		threads = (int)std::thread::hardware_concurrency();
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (threads > IMPORT_MAX_THREADS) {
+		threads = IMPORT_MAX_THREADS;
+	}
+
+	ImportPipeline* pipeline = new ImportPipeline();
+	pipeline->Citations = Citations;
+	pipeline->Slots = 2 * threads + 2;
+	pipeline->Window = (ImportChunk**)calloc(pipeline->Slots, sizeof(ImportChunk*));
+	if (pipeline->Window == NULL) {
+		printf("Insufficient memory to import file. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	pipeline->NextRead = 0;
+	pipeline->NextWork = 0;
+	pipeline->Stop = false;
+
+	std::thread* workers = new std::thread[threads];
+	for (int i = 0; i < threads; i++) {
+		workers[i] = std::thread(ImportWorker, pipeline);
+	}
+
+	char* carry = NULL;
+	size_t carryLength = 0;
+	bool endOfFile = false;
+	long long nextAdd = 0; // Next chunk to add to the library
+	double readSeconds = 0;
+	double workSeconds = 0;
+	double addSeconds = 0;
+	double bytes = 0;
+	int lines = 0;
+	int count = 0;
+	int duplicates = 0;
+	int invalid = 0;
+	double reported = 0; // Time of the last progress report
+	SetAccessDate(currentDate()); // Every citation of the file is accessed today
+
+	while (!endOfFile || nextAdd < pipeline->NextRead) {
+		// Read ahead while there is a free slot
+		if (!endOfFile && pipeline->NextRead - nextAdd < pipeline->Slots) {
+			std::chrono::steady_clock::time_point readStart = std::chrono::steady_clock::now();
+			ImportChunk* chunk = ReadChunk(file, &carry, &carryLength, &endOfFile);
+			readSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - readStart).count();
+			if (chunk != NULL) {
+				bytes += (double)chunk->Length;
+				std::lock_guard<std::mutex> guard(pipeline->Lock);
+				pipeline->Window[pipeline->NextRead % pipeline->Slots] = chunk;
+				pipeline->NextRead++;
+				pipeline->WorkReady.notify_one();
+			}
+			continue;
+		}
+
+		// Otherwise add the oldest chunk once its worker is done
+		ImportChunk* chunk = pipeline->Window[nextAdd % pipeline->Slots];
+		{
+			std::unique_lock<std::mutex> guard(pipeline->Lock);
+			pipeline->ChunkDone.wait(guard, [chunk] { return chunk->Done; });
+		}
+
+		std::chrono::steady_clock::time_point addStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < chunk->Count; i++) {
+			if (InsertCanonicalData(Citations, CitationsToProcess, chunk->URLs + chunk->Items[i].Offset, chunk->Items[i].Hash)) {
+				count++;
+			}
+			else {
+				duplicates++;
+			}
+		}
+		addSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - addStart).count();
+		lines += chunk->Lines;
+		invalid += chunk->Invalid;
+		workSeconds += chunk->Seconds;
+
+		pipeline->Window[nextAdd % pipeline->Slots] = NULL;
+		FreeChunk(chunk);
+		nextAdd++;
+
+		// Report progress of long imports
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (elapsed - reported >= IMPORT_PROGRESS_SECONDS) {
+			printf("Progress: %d lines (%.0f lines/sec), %d citations, %d duplicates, %d invalid lines.\n", lines, lines / elapsed, count, duplicates, invalid);
+			reported = elapsed;
+		}
+	}
+
+	// Stop the workers
+	{
+		std::lock_guard<std::mutex> guard(pipeline->Lock);
+		pipeline->Stop = true;
+		pipeline->WorkReady.notify_all();
+	}
+	for (int i = 0; i < threads; i++) {
+		workers[i].join();
+	}
+	delete[] workers;
+	free(pipeline->Window);
+	delete pipeline;
+	free(carry);
+
+	bool error = ferror(file) != 0;
+	if (error) {
+		printf("Error reading file.\n");
+	}
+
+	// Print throughput of each stage
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double megabytes = bytes / (1024 * 1024);
+	if (count > 0) {
+		printf("%d citations loaded from file.\n", count);
+	}
+	else {
+		printf("No data loaded from file.\n");
+	}
+	if (duplicates > 0) {
+		printf("%d URLs were already stored and skipped.\n", duplicates);
+	}
+	if (invalid > 0) {
+		printf("%d lines were not valid URLs and skipped.\n", invalid);
+	}
+	if (readSeconds > 0) {
+		printf("Read:     %.1f MB in %.2f seconds (%.0f MB/s).\n", megabytes, readSeconds, megabytes / readSeconds);
+	}
+	if (workSeconds > 0) {
+		printf("Validate: %d lines on %d threads in %.2f seconds of work (%.0f lines/sec per thread).\n", lines, threads, workSeconds, lines / workSeconds);
+	}
+	if (addSeconds > 0) {
+		printf("Add:      %d URLs in %.2f seconds (%.0f URLs/sec).\n", count + duplicates, addSeconds, (count + duplicates) / addSeconds);
+	}
+	if (seconds > 0) {
+		printf("Total:    %d lines in %.2f seconds (%.0f lines/sec).\n", lines, seconds, lines / seconds);
+	}
+
+	return !error;
+}
@@ -0,0 +1,163 @@
+/*
+* FILE          : LineReader.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the line reader used to import files. Files are read in large blocks and lines are
+*                 handed out as views into the block, so lines of any length are read without a copy or a stdio call
+*                 per line
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <io.h>
+
+#include "Citations.h"
+
+//
+// FUNCTION     : InitializeLineReader
+// DESCRIPTION  : Initializes a line reader for a file opened for reading
+// PARAMETERS   : LineReader* reader : Line reader to initialize
+//                FILE* file         : File to read lines from (not closed by the reader)
+// RETURNS      : void
+//
+void InitializeLineReader(LineReader* reader, FILE* file) {
+	reader->File = file;
+	reader->Capacity = READ_BLOCK_SIZE;
+	reader->Buffer = (char*)malloc(reader->Capacity);
+	if (reader->Buffer == NULL) {
+		printf("Insufficient memory to read file. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	reader->Start = 0;
+	reader->End = 0;
+	reader->Scanned = 0;
+	reader->Flush = NULL;
+	reader->EndOfFile = false;
+	reader->Error = false;
+}
+
+//
+// FUNCTION     : FillLineReader
+// DESCRIPTION  : Moves the unfinished line to the front of the buffer and reads the next block after it, doubling the
+//                buffer if the unfinished line fills it. The file descriptor is read directly, so a pipe or console
+//                returns the data it has instead of waiting until the whole block is filled
+// PARAMETERS   : LineReader* reader : Line reader to fill
+// RETURNS      : void
+//
+static void FillLineReader(LineReader* reader) {
+	size_t partial = reader->End - reader->Start;
+	if (reader->Start > 0) {
+		memmove(reader->Buffer, reader->Buffer + reader->Start, partial);
+		reader->Start = 0;
+		reader->End = partial;
+	}
+
+	// Keep one byte free after the data to null-terminate a last line without a newline
+	if (reader->Capacity - reader->End - 1 < READ_BLOCK_SIZE / 2) {
+		size_t capacity = reader->Capacity * 2;
+		char* buffer = (char*)realloc(reader->Buffer, capacity);
+		if (buffer == NULL) {
+			printf("Insufficient memory to read file. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		reader->Buffer = buffer;
+		reader->Capacity = capacity;
+	}
+
+	// Flush output made from the lines read so far before waiting for more input
+	if (reader->Flush != NULL) {
+		FlushBibWriter(reader->Flush);
+	}
+
+	size_t space = reader->Capacity - reader->End - 1;
+	int bytes = _read(_fileno(reader->File), reader->Buffer + reader->End, (unsigned int)(space < READ_BLOCK_SIZE ? space : READ_BLOCK_SIZE));
+	if (bytes > 0) {
+		reader->End += bytes;
+	}
+	else {
+		reader->EndOfFile = true;
+		reader->Error = bytes < 0;
+	}
+}
+
+//
+// FUNCTION     : ReadLine
+// DESCRIPTION  : Reads the next line of the file. Newlines are found with memchr, which the C runtime searches with
+//                vector instructions, and the line is null-terminated in place of its line ending ("\n" or "\r\n")
+// PARAMETERS   : LineReader* reader : Line reader to read from
+//                LineView* line     : Stores the line read
+// RETURNS      : bool               : true if a line was read, false at the end of the file or on a read error
+//
+bool ReadLine(LineReader* reader, LineView* line) {
+	char* newline = NULL;
+
+	while (true) {
+		char* start = reader->Buffer + reader->Start;
+		newline = (char*)memchr(start + reader->Scanned, '\n', reader->End - reader->Start - reader->Scanned);
+		if (newline != NULL) {
+			line->Text = start;
+			line->Length = newline - start;
+			reader->Start += line->Length + 1;
+			reader->Scanned = 0;
+			break;
+		}
+
+		// The rest of the file is the last line if it does not end with a newline
+		if (reader->EndOfFile) {
+			if (reader->Start == reader->End || reader->Error) {
+				return false;
+			}
+			newline = reader->Buffer + reader->End;
+			line->Text = start;
+			line->Length = newline - start;
+			reader->Start = reader->End;
+			reader->Scanned = 0;
+			break;
+		}
+
+		reader->Scanned = reader->End - reader->Start;
+		FillLineReader(reader);
+	}
+
+	if (line->Length > 0 && line->Text[line->Length - 1] == '\r') {
+		line->Length--;
+	}
+	line->Text[line->Length] = '\0';
+	return true;
+}
+
+//
+// FUNCTION     : trimLine
+// DESCRIPTION  : Trims any leading and/or trailing whitespace of a line in place
+// PARAMETERS   : LineView* line : Line to be trimmed
+// RETURNS      : void
+//
+void trimLine(LineView* line) {
+	while (line->Length > 0 && isspace((unsigned char)line->Text[0])) {
+		line->Text++;
+		line->Length--;
+	}
+	while (line->Length > 0 && isspace((unsigned char)line->Text[line->Length - 1])) {
+		line->Length--;
+	}
+	line->Text[line->Length] = '\0';
+}
+
+//
+// FUNCTION     : FreeLineReader
+// DESCRIPTION  : Frees the buffer of a line reader - lines read from it may not be used afterwards
+// PARAMETERS   : LineReader* reader : Line reader to free
+// RETURNS      : void
+//
+void FreeLineReader(LineReader* reader) {
+	free(reader->Buffer);
+	reader->Buffer = NULL;
+	reader->Capacity = 0;
+	reader->Start = 0;
+	reader->End = 0;
+	reader->Scanned = 0;
+}
@@ -23,6 +23,7 @@ enum menu {
 	REMOVE,
 	PROCESS,
 	EXPORT,
+	SEARCH,
 	EXIT
 } OPERATIONS;
 
@@ -32,33 +33,71 @@ int main(int argc, char* argv[])
 	CitationManager* Citations = InitializeHashTable(); // Hash Table
 	Queue* CitationsToProcess = InitializeQueue(); // Queue
 	Stack* ProcessedCitations = InitializeStack(); // Stack
-	Citation* Head = NULL; // Sorted linked list
 
 	// Initialize file pointer
 	FILE* ImportFile = NULL;
 	FILE* ExportFile = NULL;
 
 	// Command Line Arguments
-	// Non-web scraping
-	if (argc == 3) {
-		if (strcmp(argv[1], "-i") == 0) {
-			importCitationsFile(ImportFile, CitationsToProcess, argv[2]);
-			exportCitationsFile(ExportFile, CitationsToProcess, "references.bib");
-			printf("URLs from %s imported to references.bib\n", argv[2]);
+	// Output file of the import flags, given with "-o <file>" after the input file ("-" for standard output)
+	const char* output = "references.bib";
+	bool hasOutput = argc == 5 && strcmp(argv[3], "-o") == 0;
+	if (hasOutput) {
+		output = argv[4];
+	}
+
+	if (argc == 3 || hasOutput) {
+		// Import, also scraping the web for each citation with -w
+		if (strcmp(argv[1], "-i") == 0 || strcmp(argv[1], "-w") == 0) {
+			bool webScrape = strcmp(argv[1], "-w") == 0;
+
+			// Stream citations when reading from standard input ("-i -") or writing to standard output ("-o -")
+			if (strcmp(argv[2], "-") == 0 || strcmp(output, "-") == 0) {
+				if (strcmp(argv[2], "-") != 0) {
+					errno_t err = fopen_s(&ImportFile, argv[2], "rb");
+					if (err != 0) {
+						perror("Error opening file.");
+						exit(EXIT_FAILURE);
+					}
+				}
+				ImportFile = openImportStream(ImportFile != NULL ? ImportFile : stdin);
+				ExportFile = openExportFile(output);
+				streamCitations(ImportFile, ExportFile, webScrape);
+				closeExportFile(ExportFile);
+				closeImportStream(ImportFile);
+				exit(EXIT_SUCCESS);
+			}
+
+			importCitationsFile(ImportFile, Citations, CitationsToProcess, argv[2]);
+			if (webScrape) {
+				webscrapeAllCitations(Citations, CitationsToProcess);
+			}
+			exportCitationsFile(ExportFile, CitationsToProcess, output);
+			printf("URLs from %s imported to %s\n", argv[2], output);
+			exit(EXIT_SUCCESS);
+		}
+
+		// Hash function report
+		else if (strcmp(argv[1], "-r") == 0) {
+			hashReport(argv[2]);
 			exit(EXIT_SUCCESS);
 		}
 
-		else if (strcmp(argv[1], "-w") == 0) {
-			importCitationsFile(ImportFile, CitationsToProcess, argv[2]);
-			webscrapeAllCitations(CitationsToProcess);
-			exportCitationsFile(ExportFile, CitationsToProcess, "references.bib");
-			printf("URLs from %s imported to references.bib\n", argv[2]);
+		// Benchmarks of the data structures
+		else if (strcmp(argv[1], "-b") == 0) {
+			benchmarkReport(argv[2]);
 			exit(EXIT_SUCCESS);
 		}
 
+		// Number of threads used to sort and import citations - continue to the main menu
+		else if (strcmp(argv[1], "-t") == 0) {
+			SetSortThreads(atoi(argv[2]));
+			SetImportThreads(atoi(argv[2]));
+		}
+
 		// If invalid arguments entered
 		else {
-			printf("Error: Parameters not recognized. Indicate the file to import with -i flag or -w flag for web scraping.\n");
+			printf("Error: Parameters not recognized. Indicate the file to import with -i flag or -w flag for web scraping (\"-\" reads standard input), optionally followed by -o and the file to write (\"-\" writes standard output).\n");
 		}
 	}
 
@@ -92,13 +131,17 @@ int main(int argc, char* argv[])
 			break;
 
 		case PROCESS: // Process citations
-			processCitations(Head, CitationsToProcess, ProcessedCitations);
+			processCitations(Citations, CitationsToProcess, ProcessedCitations);
 			break;
 
 		case EXPORT: // Export processed citations
 			exportCitations(ExportFile, Citations, ProcessedCitations);
 			break;
 
+		case SEARCH: // Search citations by author, title, host or year
+			searchCitations(Citations);
+			break;
+
 		case EXIT: // Exit the program & free all allocated memory
 			running = false;
 			break;
@@ -114,6 +157,6 @@ int main(int argc, char* argv[])
 		}
 	}
 	// Memory Cleanup
-	exitProgram(Citations, CitationsToProcess, ProcessedCitations, Head);
+	exitProgram(Citations, CitationsToProcess, ProcessedCitations);
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,234 @@
+/*
+* FILE          : NodePool.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the pools that allocate the fixed-size nodes of the citation manager (citations,
+*                 hash table key-value pairs and ordered index nodes) from slabs. Every thread keeps a small cache of
+*                 free nodes, so allocating and freeing nodes only takes a lock once per batch
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <mutex>
+#include <atomic>
+
+#include "Citations.h"
+
+// Define constants
+#define POOL_SLAB_NODES	1024	// Number of nodes carved from each slab
+#define POOL_BATCH		64		// Number of nodes moved between a thread's cache and its pool at a time
+
+// Define free node
+// A free node holds the next free node in its first bytes (so nodes must be at least the size of a pointer)
+typedef struct PoolNode {
+	struct PoolNode* Next;
+} PoolNode;
+
+// Define slab of nodes
+typedef struct PoolSlab {
+	struct PoolSlab* Next;
+} PoolSlab;
+
+// Define Node Pool
+typedef struct NodePool {
+	size_t NodeSize;
+	PoolNode* Free; // Free nodes shared by every thread
+	PoolSlab* Slabs;
+	int SlabCount; // Number of slabs allocated (one malloc each)
+} NodePool;
+
+// Define thread cache
+// Free nodes kept by one thread for each pool. Nodes left in the cache when the thread ends go back to their pools,
+// unless the pools were freed since they were cached (the cache's generation is then older than PoolGeneration)
+typedef struct ThreadCache {
+	PoolNode* Free[POOL_COUNT];
+	int Count[POOL_COUNT];
+	unsigned int Generation;
+	~ThreadCache();
+} ThreadCache;
+
+// Pools of every node type (PoolLock is held while a pool is changed)
+static NodePool Pools[POOL_COUNT] = {
+	{ sizeof(Citation), NULL, NULL, 0 },
+	{ sizeof(CitationKVP), NULL, NULL, 0 },
+	{ sizeof(OrderNode) + (ORDER_POOL_LEVELS - 1) * sizeof(OrderNode*), NULL, NULL, 0 }
+};
+static std::mutex PoolLock;
+static std::atomic<unsigned int> PoolGeneration(0); // Number of times FreeNodePools has run
+static thread_local ThreadCache Cache = { { NULL }, { 0 }, 0 };
+
+//
+// FUNCTION     : DiscardStaleCache
+// DESCRIPTION  : Empties the calling thread's cache if the pools were freed since its nodes were cached, since those
+//                nodes were in slabs that no longer exist
+// PARAMETERS   : none
+// RETURNS      : void
+//
+static void DiscardStaleCache(void) {
+	unsigned int generation = PoolGeneration.load(std::memory_order_relaxed);
+	if (Cache.Generation != generation) {
+		for (int type = 0; type < POOL_COUNT; type++) {
+			Cache.Free[type] = NULL;
+			Cache.Count[type] = 0;
+		}
+		Cache.Generation = generation;
+	}
+}
+
+//
+// FUNCTION     : RefillCache
+// DESCRIPTION  : Moves a batch of free nodes from a pool into the calling thread's cache, carving a new slab if the
+//                pool has too few
+// PARAMETERS   : NodePoolType type : Pool to take the nodes from
+// RETURNS      : void
+//
+static void RefillCache(NodePoolType type) {
+	std::lock_guard<std::mutex> guard(PoolLock);
+	NodePool* pool = &Pools[type];
+	DiscardStaleCache();
+
+	if (pool->Free == NULL) {
+		PoolSlab* slab = (PoolSlab*)malloc(sizeof(PoolSlab) + POOL_SLAB_NODES * pool->NodeSize);
+		if (slab == NULL) {
+			printf("Insufficient memory to allocate node. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		slab->Next = pool->Slabs;
+		pool->Slabs = slab;
+		pool->SlabCount++;
+
+		// Thread every node of the slab onto the free list
+		char* nodes = (char*)(slab + 1);
+		for (int i = POOL_SLAB_NODES - 1; i >= 0; i--) {
+			PoolNode* node = (PoolNode*)(nodes + i * pool->NodeSize);
+			node->Next = pool->Free;
+			pool->Free = node;
+		}
+	}
+
+	while (pool->Free != NULL && Cache.Count[type] < POOL_BATCH) {
+		PoolNode* node = pool->Free;
+		pool->Free = node->Next;
+		node->Next = Cache.Free[type];
+		Cache.Free[type] = node;
+		Cache.Count[type]++;
+	}
+}
+
+//
+// FUNCTION     : DrainCache
+// DESCRIPTION  : Moves free nodes from the calling thread's cache back into their pool (nodes cached before the
+//                pools were last freed are dropped instead)
+// PARAMETERS   : NodePoolType type : Pool the nodes belong to
+//                int keep          : Number of nodes to leave in the cache
+// RETURNS      : void
+//
+static void DrainCache(NodePoolType type, int keep) {
+	std::lock_guard<std::mutex> guard(PoolLock);
+	NodePool* pool = &Pools[type];
+	DiscardStaleCache();
+
+	while (Cache.Count[type] > keep) {
+		PoolNode* node = Cache.Free[type];
+		Cache.Free[type] = node->Next;
+		Cache.Count[type]--;
+		node->Next = pool->Free;
+		pool->Free = node;
+	}
+}
+
+//
+// FUNCTION     : ~ThreadCache
+// DESCRIPTION  : Gives the free nodes of a thread that is ending back to their pools
+// PARAMETERS   : none
+// RETURNS      : none
+//
+ThreadCache::~ThreadCache() {
+	for (int type = 0; type < POOL_COUNT; type++) {
+		if (Count[type] > 0) {
+			DrainCache((NodePoolType)type, 0);
+		}
+	}
+}
+
+//
+// FUNCTION     : AllocateNode
+// DESCRIPTION  : Allocates a node from a pool (uninitialized, like malloc)
+// PARAMETERS   : NodePoolType type : Pool to allocate from
+// RETURNS      : void*
+//
+void* AllocateNode(NodePoolType type) {
+	DiscardStaleCache();
+	if (Cache.Free[type] == NULL) {
+		RefillCache(type);
+	}
+
+	PoolNode* node = Cache.Free[type];
+	Cache.Free[type] = node->Next;
+	Cache.Count[type]--;
+	return node;
+}
+
+//
+// FUNCTION     : FreeNode
+// DESCRIPTION  : Returns a node to its pool so it can be allocated again
+// PARAMETERS   : NodePoolType type : Pool the node was allocated from
+//                void* node        : Node to free (NULL is ignored)
+// RETURNS      : void
+//
+void FreeNode(NodePoolType type, void* node) {
+	if (node == NULL) {
+		return;
+	}
+
+	PoolNode* freed = (PoolNode*)node;
+	freed->Next = Cache.Free[type];
+	Cache.Free[type] = freed;
+	Cache.Count[type]++;
+
+	// Give half of a full cache back so nodes freed on one thread can be used by others
+	if (Cache.Count[type] >= 2 * POOL_BATCH) {
+		DrainCache(type, POOL_BATCH);
+	}
+}
+
+//
+// FUNCTION     : CountNodeSlabs
+// DESCRIPTION  : Returns the number of slabs a pool has allocated, each one a single malloc of POOL_SLAB_NODES nodes
+// PARAMETERS   : NodePoolType type : Pool to count the slabs of
+// RETURNS      : int
+//
+int CountNodeSlabs(NodePoolType type) {
+	std::lock_guard<std::mutex> guard(PoolLock);
+	return Pools[type].SlabCount;
+}
+
+//
+// FUNCTION     : FreeNodePools
+// DESCRIPTION  : Frees every slab of every pool - no node may be used afterwards, and no other thread may allocate
+//                nodes while this runs. Other threads may still have nodes cached: the new generation makes them
+//                drop those nodes instead of using them or giving them back to the pools
+// PARAMETERS   : none
+// RETURNS      : void
+//
+void FreeNodePools(void) {
+	std::lock_guard<std::mutex> guard(PoolLock);
+
+	for (int type = 0; type < POOL_COUNT; type++) {
+		PoolSlab* current = Pools[type].Slabs;
+		PoolSlab* next = NULL;
+		while (current != NULL) {
+			next = current->Next;
+			free(current);
+			current = next;
+		}
+		Pools[type].Slabs = NULL;
+		Pools[type].Free = NULL;
+		Pools[type].SlabCount = 0;
+	}
+	PoolGeneration++;
+	DiscardStaleCache();
+}
@@ -25,7 +25,7 @@ void parseJSON(char* json, Citation* citation) {
 	// Create root node of JSON object & exit if failure to create json_object
 	json_object* root = json_tokener_parse(json);
 	if (root == NULL) {
-		printf("Error reading JSON data.\n");
+		fprintf(stderr, "Error reading JSON data.\n");
 		return;
 	}
 
@@ -34,8 +34,7 @@ void parseJSON(char* json, Citation* citation) {
 	json_object* temp = NULL; // Store JSON object at each index
 
 	// Extract year
-	char* dateModified; // Store dateModified string
-	char* extractedYear;
+	const char* dateModified; // Store dateModified string (owned by the JSON object)
 	std::regex rgx("^(\\d{4})(?:.+)"); // regex to match year in dateModified
 	std::cmatch match;
 	int year = 0;
@@ -44,7 +43,7 @@ void parseJSON(char* json, Citation* citation) {
 	json_object_object_foreach(root, key1, val1) {
 		// Extract title
 		if (strcmp(key1, "headline") == 0) {
-			citation->Title = _strdup(json_object_get_string(val1));
+			SetCitationTitle(citation, json_object_get_string(val1));
 		}
 
 		// Extract author
@@ -58,7 +57,7 @@ void parseJSON(char* json, Citation* citation) {
 					temp = json_object_array_get_idx(author, i);
 					json_object_object_foreach(temp, key2, val2) {
 						if (strcmp(key2, "name") == 0) {
-							citation->Author = _strdup(json_object_get_string(val2));
+							SetCitationAuthor(citation, json_object_get_string(val2));
 							break;
 						}
 					}
@@ -68,7 +67,7 @@ void parseJSON(char* json, Citation* citation) {
 			else {
 				json_object_object_foreach(author, key2, val2) {
 					if (strcmp(key2, "name") == 0) {
-						citation->Author = _strdup(json_object_get_string(val2));
+						SetCitationAuthor(citation, json_object_get_string(val2));
 						break;
 					}
 				}
@@ -77,20 +76,18 @@ void parseJSON(char* json, Citation* citation) {
 
 		// Extract year
 		if (strcmp(key1, "datePublished") == 0) {
-			dateModified = _strdup(json_object_get_string(val1));
+			dateModified = json_object_get_string(val1);
 			if (std::regex_search(dateModified, match, rgx)) {
-				extractedYear = _strdup(match[1].first);
-				sscanf_s(extractedYear, "%d", &year);
-				citation->Year = year;
+				sscanf_s(match[1].first, "%d", &year);
+				SetCitationYear(citation, year);
 			}
 		}
 
 		if (strcmp(key1, "dateModified") == 0) { // Overwrite with modified year if available
-			dateModified = _strdup(json_object_get_string(val1));
+			dateModified = json_object_get_string(val1);
 			if (std::regex_search(dateModified, match, rgx)) {
-				extractedYear = _strdup(match[1].first);
-				sscanf_s(extractedYear, "%d", &year);
-				citation->Year = year;
+				sscanf_s(match[1].first, "%d", &year);
+				SetCitationYear(citation, year);
 			}
 		}
 
@@ -107,14 +104,14 @@ void parseJSON(char* json, Citation* citation) {
 					// Extract name of website (if author is not found)
 					if (strcmp(key2, "@type") == 0 && strcmp(json_object_get_string(val2), "WebSite") == 0) {
 						json_object* title_website = json_object_object_get(temp, "name");
-						citation->Author = _strdup(json_object_get_string(title_website));
+						SetCitationAuthor(citation, json_object_get_string(title_website));
 					}
 
 					// Drill down to @type : WebPage
 					// Extract title
 					if (strcmp(key2, "@type") == 0 && strcmp(json_object_get_string(val2), "WebPage") == 0) {
 						json_object* title = json_object_object_get(temp, "name");
-						citation->Title = _strdup(json_object_get_string(title));
+						SetCitationTitle(citation, json_object_get_string(title));
 					}
 
 					// Extract author
@@ -124,25 +121,23 @@ void parseJSON(char* json, Citation* citation) {
 						json_object_object_foreach(author, key3, val3) {
 							// Extract author
 							if (strcmp(key3, "name") == 0) {
-								citation->Author = _strdup(json_object_get_string(val3));
+								SetCitationAuthor(citation, json_object_get_string(val3));
 							}
 						}
 					}
 					// Extract year
 					if (strcmp(key2, "datePublished") == 0) {
-						dateModified = _strdup(json_object_get_string(val2));
+						dateModified = json_object_get_string(val2);
 						if (std::regex_search(dateModified, match, rgx)) {
-							extractedYear = _strdup(match[1].first);
-							sscanf_s(extractedYear, "%d", &year);
-							citation->Year = year;
+							sscanf_s(match[1].first, "%d", &year);
+							SetCitationYear(citation, year);
 						}
 					}
 					if (strcmp(key2, "dateModified") == 0) { // Overwrite with modified year if available
-						dateModified = _strdup(json_object_get_string(val2));
+						dateModified = json_object_get_string(val2);
 						if (std::regex_search(dateModified, match, rgx)) {
-							extractedYear = _strdup(match[1].first);
-							sscanf_s(extractedYear, "%d", &year);
-							citation->Year = year;
+							sscanf_s(match[1].first, "%d", &year);
+							SetCitationYear(citation, year);
 						}
 					}
 				}
@@ -150,9 +145,6 @@ void parseJSON(char* json, Citation* citation) {
 		}
 	}
 
-	// Memory cleanup
+	// Memory cleanup (temp belongs to root, so it is freed with it)
 	json_object_put(root);
-	if (temp != NULL) {
-		json_object_put(temp);
-	}
 }
\ No newline at end of file
@@ -10,14 +10,16 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
-#include <regex>
 
 #include "Citations.h"
 
+// Define constants
+#define QUEUE_SIZE	16	// Initial number of citations the queue can hold (must be a power of 2)
+
 //
 // FUNCTION     : InitializeQueue
-// DESCRIPTION  : Dynamically allocates queue & initializes front & back nodes
-// PARAMETERS   : none 
+// DESCRIPTION  : Dynamically allocates queue & its ring buffer of citations
+// PARAMETERS   : none
 // RETURNS      : Queue*
 //
 struct Queue* InitializeQueue() {
@@ -28,28 +30,97 @@ struct Queue* InitializeQueue() {
 		exit(EXIT_FAILURE);
 	}
 
-	// Initialize front & back nodes of queue
-	CitationsToProcess->Front = NULL;
-	CitationsToProcess->Back = NULL;
+	// Initialize empty ring buffer
+	CitationsToProcess->Items = (Citation**)malloc(QUEUE_SIZE * sizeof(Citation*));
+	if (CitationsToProcess->Items == NULL) {
+		printf("Insufficient memory to create queue. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	CitationsToProcess->Capacity = QUEUE_SIZE;
+	CitationsToProcess->Front = 0;
+	CitationsToProcess->Count = 0;
+	CitationsToProcess->Removed = 0;
 
 	return CitationsToProcess;
 }
 
 //
 // FUNCTION     : isQueueEmpty
-// DESCRIPTION  : Returns boolean if queue is empty by checking the Front pointer
+// DESCRIPTION  : Returns boolean if queue is empty by checking the number of citations
 // PARAMETERS   : Queue* CitationsToProcess	: Queue to store citations that need to be processed
 // RETURNS      : bool
 //
 bool isQueueEmpty(Queue* CitationsToProcess) {
-	return CitationsToProcess->Front == NULL;
+	return CitationsToProcess->Count == 0;
+}
+
+//
+// FUNCTION     : QueueAt
+// DESCRIPTION  : Returns the citation in a slot of the queue (0 is the front)
+// PARAMETERS   : Queue* CitationsToProcess	: Queue to store citations that need to be processed
+//				  int position				: Slot from the front (less than CitationsToProcess->Count)
+// RETURNS      : Citation*					: Citation in the slot, or NULL if it was removed
+//
+Citation* QueueAt(Queue* CitationsToProcess, int position) {
+	return CitationsToProcess->Items[(CitationsToProcess->Front + position) & (CitationsToProcess->Capacity - 1)];
+}
+
+//
+// FUNCTION     : RebuildQueue
+// DESCRIPTION  : Moves the citations of the queue into a new ring buffer with the front at the start, dropping
+//				  tombstones and updating the position of every citation
+// PARAMETERS   : Queue* CitationsToProcess	: Queue to store citations that need to be processed
+//				  int capacity				: Capacity of the new ring buffer (a power of 2)
+// RETURNS      : void
+//
+static void RebuildQueue(Queue* CitationsToProcess, int capacity) {
+	Citation** items = (Citation**)malloc(capacity * sizeof(Citation*));
+	if (items == NULL) {
+		printf("Insufficient memory to add to queue. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+
+	int count = 0;
+	for (int i = 0; i < CitationsToProcess->Count; i++) {
+		Citation* citation = QueueAt(CitationsToProcess, i);
+		if (citation != NULL) {
+			items[count] = citation;
+			citation->Position = count;
+			count++;
+		}
+	}
+
+	free(CitationsToProcess->Items);
+	CitationsToProcess->Items = items;
+	CitationsToProcess->Capacity = capacity;
+	CitationsToProcess->Front = 0;
+	CitationsToProcess->Count = count;
+	CitationsToProcess->Removed = 0;
+}
+
+//
+// FUNCTION     : TrimQueue
+// DESCRIPTION  : Drops tombstones from the front and back of the queue
+// PARAMETERS   : Queue* CitationsToProcess	: Queue to store citations that need to be processed
+// RETURNS      : void
+//
+static void TrimQueue(Queue* CitationsToProcess) {
+	while (CitationsToProcess->Count > 0 && QueueAt(CitationsToProcess, 0) == NULL) {
+		CitationsToProcess->Front = (CitationsToProcess->Front + 1) & (CitationsToProcess->Capacity - 1);
+		CitationsToProcess->Count--;
+		CitationsToProcess->Removed--;
+	}
+	while (CitationsToProcess->Count > 0 && QueueAt(CitationsToProcess, CitationsToProcess->Count - 1) == NULL) {
+		CitationsToProcess->Count--;
+		CitationsToProcess->Removed--;
+	}
 }
 
 //
 // FUNCTION     : Enqueue
-// DESCRIPTION  : Adds a Citation node to the back of the queue
+// DESCRIPTION  : Adds a Citation node to the back of the queue and marks it as pending
 // PARAMETERS   : Queue* CitationsToProcess	: Queue to store citations that need to be processed
-//				  Citation& newCitation		: Citation node to be enqueued
+//				  Citation* newCitation		: Handle of the citation to be enqueued
 // RETURNS      : none
 //
 void Enqueue(Queue* CitationsToProcess, Citation* newCitation) {
@@ -63,22 +134,25 @@ void Enqueue(Queue* CitationsToProcess, Citation* newCitation) {
 		return;
 	}
 
-	// If queue is empty, add newCitation as front and back
-	if (isQueueEmpty(CitationsToProcess)) {
-		CitationsToProcess->Front = newCitation;
-		CitationsToProcess->Back = newCitation;
-	}
-	// If queue is not empty, add newCitation as the back
-	else {
-		CitationsToProcess->Back->Next = newCitation;
-		CitationsToProcess->Back = newCitation;
+	// If ring buffer is full, clear out tombstones, growing it if it is still more than half full
+	if (CitationsToProcess->Count == CitationsToProcess->Capacity) {
+		int live = CitationsToProcess->Count - CitationsToProcess->Removed;
+		int capacity = live * 2 > CitationsToProcess->Capacity ? CitationsToProcess->Capacity * 2 : CitationsToProcess->Capacity;
+		RebuildQueue(CitationsToProcess, capacity);
 	}
+
+	// Add newCitation as the back
+	int back = (CitationsToProcess->Front + CitationsToProcess->Count) & (CitationsToProcess->Capacity - 1);
+	CitationsToProcess->Items[back] = newCitation;
+	CitationsToProcess->Count++;
+	newCitation->Position = back;
+	SetCitationState(newCitation, CITATION_PENDING);
 }
 
 //
 // FUNCTION     : Dequeue
 // DESCRIPTION  : Removes a node from the queue (FIFO) and citation that was removed
-// PARAMETERS   : Queue* CitationsToProcess : Queue to store citations that need to be processed
+// PARAMETERS   : Queue* CitationsToProcess	: Queue to store citations that need to be processed
 // RETURNS      : Citation*
 //
 Citation* Dequeue(Queue* CitationsToProcess) {
@@ -91,45 +165,76 @@ Citation* Dequeue(Queue* CitationsToProcess) {
 		return nullCitation;
 	}
 
-	// Store citation to dequeue
-	Citation* nodeToDequeue = CitationsToProcess->Front;
+	// Store citation to dequeue and move front to next citation
+	Citation* nodeToDequeue = CitationsToProcess->Items[CitationsToProcess->Front];
+	CitationsToProcess->Items[CitationsToProcess->Front] = NULL;
+	CitationsToProcess->Front = (CitationsToProcess->Front + 1) & (CitationsToProcess->Capacity - 1);
+	CitationsToProcess->Count--;
+	TrimQueue(CitationsToProcess);
+
+	nodeToDequeue->Position = -1;
+	return nodeToDequeue;
+}
 
-	// Check if there is only one citation in the queue
-	if (CitationsToProcess->Front == CitationsToProcess->Back) {
-		CitationsToProcess->Front = NULL;
-		CitationsToProcess->Back = NULL;
+//
+// FUNCTION     : RemoveFromQueue
+// DESCRIPTION  : Removes a citation from anywhere in the queue in constant time using its position, leaving a
+//				  tombstone. The queue is compacted once more than half of its slots are tombstones
+// PARAMETERS   : Queue* CitationsToProcess	: Queue to store citations that need to be processed
+//				  Citation* citation		: Citation to remove
+// RETURNS      : bool						: true if the citation was in the queue
+//
+bool RemoveFromQueue(Queue* CitationsToProcess, Citation* citation) {
+	if (citation->Position < 0 || citation->Position >= CitationsToProcess->Capacity ||
+		CitationsToProcess->Items[citation->Position] != citation) {
+		return false;
 	}
-	// More than one citation in the queue
-	else {
-		// Change queue's front to next node
-		CitationsToProcess->Front = CitationsToProcess->Front->Next;
+
+	CitationsToProcess->Items[citation->Position] = NULL;
+	CitationsToProcess->Removed++;
+	citation->Position = -1;
+	TrimQueue(CitationsToProcess);
+
+	if (CitationsToProcess->Removed * 2 > CitationsToProcess->Count) {
+		RebuildQueue(CitationsToProcess, CitationsToProcess->Capacity);
 	}
+	return true;
+}
 
-	return nodeToDequeue;
+//
+// FUNCTION     : printQueue
+// DESCRIPTION  : Prints all citations in the queue from front to back
+// PARAMETERS   : Queue* CitationsToProcess	: Queue to store citations that need to be processed
+// RETURNS      : void
+//
+void printQueue(Queue* CitationsToProcess) {
+	for (int i = 0; i < CitationsToProcess->Count; i++) {
+		Citation* citation = QueueAt(CitationsToProcess, i);
+		if (citation != NULL) {
+			printCitation(citation);
+			printf("---------------------------------------------\n");
+		}
+	}
 }
 
 //
 // FUNCTION     : FreeQueue
-// DESCRIPTION  : Releases memory allocated in queue
+// DESCRIPTION  : Releases memory allocated in queue. The citations in it are not visited - they are freed all at once
+//				  with the citation store and node pools (see freeMemory)
 // PARAMETERS   : Queue* CitationsToProcess : Queue to store citations that need to be processed
 // RETURNS      : None
 //
 void FreeQueue(Queue* CitationsToProcess) {
-	// Check if queue is empty
-	if (isQueueEmpty(CitationsToProcess)) {
-		return;
-	}
-
-	// Free memory allocated in queue
-	Citation* toFree;
-	while (CitationsToProcess->Front != NULL) {
-		toFree = Dequeue(CitationsToProcess); // Obtain node to be freed
-		CitationsToProcess->Front = toFree->Next; // Change front to the next node
-		free(toFree); // Free node
+	// Free the ring buffer
+	bool hadCitations = !isQueueEmpty(CitationsToProcess);
+	free(CitationsToProcess->Items);
+	CitationsToProcess->Items = NULL;
+	CitationsToProcess->Capacity = 0;
+	CitationsToProcess->Front = 0;
+	CitationsToProcess->Count = 0;
+	CitationsToProcess->Removed = 0;
+
+	if (hadCitations) {
+		printf("Queue was completely freed.\n");
 	}
-
-	// Change back node pointer to NULL
-	CitationsToProcess->Back = NULL;
-
-	printf("Queue was completely freed.\n");
-}
\ No newline at end of file
+}
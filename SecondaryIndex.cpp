@@ -0,0 +1,831 @@
+/*
+* FILE          : SecondaryIndex.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the secondary indexes of the citation manager - citations by year (kept in year
+*                 order for range queries), by website host, by the words in their author and title, and in sort order
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "Citations.h"
+
+// Define constants
+#define TERM_INDEX_SIZE	256	// Initial number of slots in a term index (must be a power of 2)
+#define POSTINGS_SIZE	4	// Initial number of citations in a postings list
+#define POSTINGS_SLOTS_MIN	32	// Capacity from which a postings list keeps slots to find its citations
+#define SEARCH_MAX_WORDS	16	// Words of a search that are looked up (any more are ignored)
+
+//
+// FUNCTION     : PostingHash
+// DESCRIPTION  : Hashes a citation pointer for the slots of a postings list
+// PARAMETERS   : Citation* citation : Citation to hash
+// RETURNS      : unsigned int
+//
+static inline unsigned int PostingHash(Citation* citation) {
+	return (unsigned int)(((unsigned long long)(size_t)citation * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+//
+// FUNCTION     : FindPostingSlot
+// DESCRIPTION  : Finds the slot of a citation in a postings list's slots, or the empty slot where it would go
+// PARAMETERS   : Postings* list     : Postings list (its slots must be built)
+//                Citation* citation : Citation to look for
+// RETURNS      : int                : Slot of the citation
+//
+static int FindPostingSlot(Postings* list, Citation* citation) {
+	int mask = list->SlotCapacity - 1;
+	int slot = (int)(PostingHash(citation) & (unsigned int)mask);
+	while (list->Slots[slot] >= 0 && list->Items[list->Slots[slot]] != citation) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+//
+// FUNCTION     : BuildPostingSlots
+// DESCRIPTION  : Rebuilds the slots of a postings list for its current capacity
+// PARAMETERS   : Postings* list : Postings list
+// RETURNS      : void
+//
+static void BuildPostingSlots(Postings* list) {
+	free(list->Slots);
+	list->SlotCapacity = list->Capacity * 2;
+	list->Slots = (int*)malloc(list->SlotCapacity * sizeof(int));
+	if (list->Slots == NULL) {
+		printf("Insufficient memory to index citation. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	memset(list->Slots, 0xFF, list->SlotCapacity * sizeof(int));
+
+	for (int i = 0; i < list->Count; i++) {
+		list->Slots[FindPostingSlot(list, list->Items[i])] = i;
+	}
+}
+
+//
+// FUNCTION     : DeletePostingSlot
+// DESCRIPTION  : Empties a slot of a postings list, moving later slots of the same probe run back so every citation
+//                can still be found (no tombstones are left)
+// PARAMETERS   : Postings* list : Postings list
+//                int slot       : Slot to empty
+// RETURNS      : void
+//
+static void DeletePostingSlot(Postings* list, int slot) {
+	int mask = list->SlotCapacity - 1;
+	int hole = slot;
+	int next = (hole + 1) & mask;
+	while (list->Slots[next] >= 0) {
+		int home = (int)(PostingHash(list->Items[list->Slots[next]]) & (unsigned int)mask);
+		// Move the entry into the hole unless its home slot lies between the hole and the entry
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			list->Slots[hole] = list->Slots[next];
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+	list->Slots[hole] = -1;
+}
+
+//
+// FUNCTION     : AddPosting
+// DESCRIPTION  : Appends a citation to a postings list, unless it was the last citation added to the list
+// PARAMETERS   : Postings* list    : Postings list
+//                Citation* citation : Citation to add
+// RETURNS      : void
+//
+static void AddPosting(Postings* list, Citation* citation) {
+	// A word repeated in one field would otherwise add the same citation twice in a row
+	if (list->Count > 0 && list->Items[list->Count - 1] == citation) {
+		return;
+	}
+
+	if (list->Count == list->Capacity) {
+		list->Capacity = list->Capacity == 0 ? POSTINGS_SIZE : list->Capacity * 2;
+		list->Items = (Citation**)realloc(list->Items, list->Capacity * sizeof(Citation*));
+		if (list->Items == NULL) {
+			printf("Insufficient memory to index citation. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		if (list->Capacity >= POSTINGS_SLOTS_MIN) {
+			BuildPostingSlots(list);
+		}
+	}
+
+	list->Items[list->Count] = citation;
+	if (list->Slots != NULL) {
+		list->Slots[FindPostingSlot(list, citation)] = list->Count;
+	}
+	list->Count++;
+}
+
+//
+// FUNCTION     : RemovePosting
+// DESCRIPTION  : Removes a citation from a postings list by moving the last citation into its place. A long list finds
+//                the citation through its slots, so removal takes O(1) however many citations share the year, host or
+//                word
+// PARAMETERS   : Postings* list    : Postings list
+//                Citation* citation : Citation to remove
+// RETURNS      : void
+//
+static void RemovePosting(Postings* list, Citation* citation) {
+	int position = -1;
+	int last = list->Count - 1;
+
+	if (list->Slots != NULL) {
+		int slot = FindPostingSlot(list, citation);
+		position = list->Slots[slot];
+		if (position < 0) {
+			return;
+		}
+		DeletePostingSlot(list, slot);
+		if (position != last) {
+			list->Slots[FindPostingSlot(list, list->Items[last])] = position;
+		}
+	}
+	else {
+		// Short lists are scanned
+		for (int i = 0; i <= last && position < 0; i++) {
+			if (list->Items[i] == citation) {
+				position = i;
+			}
+		}
+		if (position < 0) {
+			return;
+		}
+	}
+
+	list->Items[position] = list->Items[last];
+	list->Count--;
+}
+
+//
+// FUNCTION     : FindTerm
+// DESCRIPTION  : Finds the slot of a term in a term index, or the empty slot where it would be stored
+// PARAMETERS   : TermIndex* index         : Term index
+//                const char* term         : Term to look for
+//                size_t length            : Length of the term
+//                unsigned long long hash  : Hash of the term
+// RETURNS      : TermEntry*
+//
+static TermEntry* FindTerm(TermIndex* index, const char* term, size_t length, unsigned long long hash) {
+	unsigned int slot = (unsigned int)hash & (index->Capacity - 1);
+	while (index->Entries[slot].Term != NULL) {
+		TermEntry* entry = &index->Entries[slot];
+		if (entry->Hash == hash && strlen(entry->Term) == length && strncmp(entry->Term, term, length) == 0) {
+			return entry;
+		}
+		slot = (slot + 1) & (index->Capacity - 1);
+	}
+	return &index->Entries[slot];
+}
+
+//
+// FUNCTION     : GrowTermIndex
+// DESCRIPTION  : Doubles the number of slots in a term index and reinserts every term
+// PARAMETERS   : TermIndex* index : Term index
+// RETURNS      : void
+//
+static void GrowTermIndex(TermIndex* index) {
+	TermEntry* oldEntries = index->Entries;
+	unsigned int oldCapacity = index->Capacity;
+
+	index->Capacity = oldCapacity == 0 ? TERM_INDEX_SIZE : oldCapacity * 2;
+	index->Entries = (TermEntry*)calloc(index->Capacity, sizeof(TermEntry));
+	if (index->Entries == NULL) {
+		printf("Insufficient memory to index citation. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (unsigned int i = 0; i < oldCapacity; i++) {
+		if (oldEntries[i].Term != NULL) {
+			unsigned int slot = (unsigned int)oldEntries[i].Hash & (index->Capacity - 1);
+			while (index->Entries[slot].Term != NULL) {
+				slot = (slot + 1) & (index->Capacity - 1);
+			}
+			index->Entries[slot] = oldEntries[i];
+		}
+	}
+
+	free(oldEntries);
+}
+
+//
+// FUNCTION     : AddTerm
+// DESCRIPTION  : Adds a citation to the postings list of a term, creating the term if it is new
+// PARAMETERS   : TermIndex* index   : Term index
+//                const char* term   : Term (does not need to be null-terminated)
+//                size_t length      : Length of the term
+//                Citation* citation : Citation to add
+// RETURNS      : void
+//
+static void AddTerm(TermIndex* index, const char* term, size_t length, Citation* citation) {
+	// Keep the index at most half full
+	if ((index->Count + 1) * 2 > index->Capacity) {
+		GrowTermIndex(index);
+	}
+
+	unsigned long long hash = HashFast(term, length);
+	TermEntry* entry = FindTerm(index, term, length, hash);
+	if (entry->Term == NULL) {
+		entry->Term = (char*)malloc(length + 1);
+		if (entry->Term == NULL) {
+			printf("Insufficient memory to index citation. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		memcpy(entry->Term, term, length);
+		entry->Term[length] = '\0';
+		entry->Hash = hash;
+		entry->List.Items = NULL;
+		entry->List.Count = 0;
+		entry->List.Capacity = 0;
+		entry->List.Slots = NULL;
+		entry->List.SlotCapacity = 0;
+		index->Count++;
+	}
+
+	AddPosting(&entry->List, citation);
+}
+
+//
+// FUNCTION     : RemoveTerm
+// DESCRIPTION  : Removes a citation from the postings list of a term (the term is kept, even if its list is empty)
+// PARAMETERS   : TermIndex* index   : Term index
+//                const char* term   : Term (does not need to be null-terminated)
+//                size_t length      : Length of the term
+//                Citation* citation : Citation to remove
+// RETURNS      : void
+//
+static void RemoveTerm(TermIndex* index, const char* term, size_t length, Citation* citation) {
+	if (index->Capacity == 0) {
+		return;
+	}
+
+	TermEntry* entry = FindTerm(index, term, length, HashFast(term, length));
+	if (entry->Term != NULL) {
+		RemovePosting(&entry->List, citation);
+	}
+}
+
+//
+// FUNCTION     : NextToken
+// DESCRIPTION  : Finds the next word in a string and writes it lowercased. Words are split on anything that is not a
+//                letter or digit; single letters and the word "and" (used between authors) are skipped
+// PARAMETERS   : const char** str  : Position in the string (moved past the word)
+//                char* token       : Buffer of LINE_SIZE bytes to store the word
+// RETURNS      : size_t            : Length of the word, or 0 if there are no more words
+//
+static size_t NextToken(const char** str, char* token) {
+	const char* p = *str;
+
+	while (*p != '\0') {
+		// Skip separators (bytes >= 0x80 are part of UTF-8 letters)
+		while (*p != '\0' && !isalnum((unsigned char)*p) && (unsigned char)*p < 0x80) {
+			p++;
+		}
+
+		size_t length = 0;
+		while (*p != '\0' && (isalnum((unsigned char)*p) || (unsigned char)*p >= 0x80)) {
+			if (length < LINE_SIZE - 1) {
+				token[length++] = (char)tolower((unsigned char)*p);
+			}
+			p++;
+		}
+
+		if (length > 1 && !(length == 3 && strncmp(token, "and", 3) == 0)) {
+			token[length] = '\0';
+			*str = p;
+			return length;
+		}
+	}
+
+	*str = p;
+	return 0;
+}
+
+//
+// FUNCTION     : URLHost
+// DESCRIPTION  : Finds the host of a canonical URL (without user info or port)
+// PARAMETERS   : const char* url  : Canonical URL
+//                size_t* length   : Set to the length of the host
+// RETURNS      : const char*      : Start of the host
+//
+const char* URLHost(const char* url, size_t* length) {
+	const char* host = URLKey(url);
+	const char* end = host;
+	while (*end != '\0' && *end != '/' && *end != '?' && *end != '#') {
+		if (*end == '@') {
+			host = end + 1;
+		}
+		end++;
+	}
+
+	// Drop port
+	const char* port = end;
+	while (port > host && isdigit((unsigned char)port[-1])) {
+		port--;
+	}
+	if (port > host && port[-1] == ':') {
+		end = port - 1;
+	}
+
+	*length = (size_t)(end - host);
+	return host;
+}
+
+//
+// FUNCTION     : FindYear
+// DESCRIPTION  : Binary searches the year index for the first entry with a year greater than or equal to a year
+// PARAMETERS   : YearIndex* index : Year index
+//                int year         : Year to look for
+// RETURNS      : int              : Position of the entry (index->Count if every year is smaller)
+//
+static int FindYear(YearIndex* index, int year) {
+	int low = 0;
+	int high = index->Count;
+	while (low < high) {
+		int middle = (low + high) / 2;
+		if (index->Entries[middle].Year < year) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+//
+// FUNCTION     : AddYear
+// DESCRIPTION  : Adds a citation to the postings list of its year, inserting the year in order if it is new
+// PARAMETERS   : YearIndex* index   : Year index
+//                Citation* citation : Citation to add
+// RETURNS      : void
+//
+static void AddYear(YearIndex* index, Citation* citation) {
+	int position = FindYear(index, GetCitationYear(citation));
+
+	if (position == index->Count || index->Entries[position].Year != GetCitationYear(citation)) {
+		if (index->Count == index->Capacity) {
+			index->Capacity = index->Capacity == 0 ? POSTINGS_SIZE : index->Capacity * 2;
+			index->Entries = (YearEntry*)realloc(index->Entries, index->Capacity * sizeof(YearEntry));
+			if (index->Entries == NULL) {
+				printf("Insufficient memory to index citation. Exiting program...\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		memmove(&index->Entries[position + 1], &index->Entries[position], (index->Count - position) * sizeof(YearEntry));
+		index->Entries[position].Year = GetCitationYear(citation);
+		index->Entries[position].List.Items = NULL;
+		index->Entries[position].List.Count = 0;
+		index->Entries[position].List.Capacity = 0;
+		index->Entries[position].List.Slots = NULL;
+		index->Entries[position].List.SlotCapacity = 0;
+		index->Count++;
+	}
+
+	AddPosting(&index->Entries[position].List, citation);
+}
+
+//
+// FUNCTION     : OrderBefore
+// DESCRIPTION  : Checks if one citation comes before another in sort order (reverse-alphabetically by collation key,
+//                then by the order they were first indexed)
+// PARAMETERS   : Citation* citation1 : First citation (its collation key must be built)
+//                Citation* citation2 : Second citation (its collation key must be built)
+// RETURNS      : bool
+//
+static bool OrderBefore(Citation* citation1, Citation* citation2) {
+	int length = citation1->CollationLength < citation2->CollationLength ? citation1->CollationLength : citation2->CollationLength;
+	int diff = memcmp(citation1->CollationKey, citation2->CollationKey, length + 1);
+	if (diff != 0) {
+		return diff > 0;
+	}
+	return citation1->Sequence < citation2->Sequence;
+}
+
+//
+// FUNCTION     : FindOrderPath
+// DESCRIPTION  : Finds the last node before a citation's place in the ordered index at every level
+// PARAMETERS   : OrderedIndex* order  : Ordered index
+//                Citation* citation   : Citation to find the place of
+//                OrderNode** path     : Set to the last node before the place at each of the ORDER_MAX_LEVEL levels
+// RETURNS      : void
+//
+static void FindOrderPath(OrderedIndex* order, Citation* citation, OrderNode** path) {
+	OrderNode* current = order->Head;
+	for (int level = ORDER_MAX_LEVEL - 1; level >= order->Level; level--) {
+		path[level] = current;
+	}
+	for (int level = order->Level - 1; level >= 0; level--) {
+		while (current->Next[level] != NULL && OrderBefore(current->Next[level]->Citation, citation)) {
+			current = current->Next[level];
+		}
+		path[level] = current;
+	}
+}
+
+//
+// FUNCTION     : FreeOrderNode
+// DESCRIPTION  : Frees a node of the ordered index, returning it to the node pool if it came from there
+// PARAMETERS   : OrderNode* node : Node to free
+// RETURNS      : void
+//
+static void FreeOrderNode(OrderNode* node) {
+	if (node->Level <= ORDER_POOL_LEVELS) {
+		FreeNode(POOL_ORDER, node);
+	}
+	else {
+		free(node);
+	}
+}
+
+//
+// FUNCTION     : AddOrder
+// DESCRIPTION  : Inserts a citation into the ordered index in O(log n)
+// PARAMETERS   : OrderedIndex* order : Ordered index
+//                Citation* citation  : Citation to insert (its collation key must be built)
+// RETURNS      : void
+//
+static void AddOrder(OrderedIndex* order, Citation* citation) {
+	OrderNode* path[ORDER_MAX_LEVEL];
+	FindOrderPath(order, citation, path);
+
+	// Pick a level: each level above the first is used by a quarter of the nodes of the level below (xorshift64)
+	order->Random ^= order->Random << 13;
+	order->Random ^= order->Random >> 7;
+	order->Random ^= order->Random << 17;
+	unsigned long long bits = order->Random;
+	int level = 1;
+	while (level < ORDER_MAX_LEVEL && (bits & 3) == 0) {
+		level++;
+		bits >>= 2;
+	}
+
+	OrderNode* node = NULL;
+	if (level <= ORDER_POOL_LEVELS) {
+		node = (OrderNode*)AllocateNode(POOL_ORDER);
+	}
+	else {
+		node = (OrderNode*)malloc(sizeof(OrderNode) + (level - 1) * sizeof(OrderNode*));
+	}
+	if (node == NULL) {
+		printf("Insufficient memory to index citation. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	node->Citation = citation;
+	node->Level = level;
+	for (int i = 0; i < level; i++) {
+		node->Next[i] = path[i]->Next[i];
+		path[i]->Next[i] = node;
+	}
+
+	if (level > order->Level) {
+		order->Level = level;
+	}
+	order->Count++;
+}
+
+//
+// FUNCTION     : RemoveOrder
+// DESCRIPTION  : Removes a citation from the ordered index in O(log n). The citation's collation key must be the one
+//                it was inserted with
+// PARAMETERS   : OrderedIndex* order : Ordered index
+//                Citation* citation  : Citation to remove
+// RETURNS      : void
+//
+static void RemoveOrder(OrderedIndex* order, Citation* citation) {
+	OrderNode* path[ORDER_MAX_LEVEL];
+	FindOrderPath(order, citation, path);
+
+	OrderNode* node = path[0]->Next[0];
+	if (node == NULL || node->Citation != citation) {
+		return;
+	}
+
+	for (int i = 0; i < node->Level; i++) {
+		path[i]->Next[i] = node->Next[i];
+	}
+	FreeOrderNode(node);
+	order->Count--;
+}
+
+//
+// FUNCTION     : FirstOrdered
+// DESCRIPTION  : Returns the first node of the ordered index. Following Next[0] visits every indexed citation in the
+//                order SortQueue sorts them in. The nodes belong to the index, so they must not be used while another
+//                thread changes the indexes
+// PARAMETERS   : CitationIndexes* indexes : Secondary indexes
+// RETURNS      : OrderNode*               : First node, or NULL if no citation is indexed
+//
+OrderNode* FirstOrdered(CitationIndexes* indexes) {
+	std::lock_guard<std::mutex> guard(*indexes->Lock);
+	return indexes->Order.Head->Next[0];
+}
+
+//
+// FUNCTION     : OrderedCount
+// DESCRIPTION  : Returns the number of citations in the ordered index (every citation in the library)
+// PARAMETERS   : CitationIndexes* indexes : Secondary indexes
+// RETURNS      : int
+//
+int OrderedCount(CitationIndexes* indexes) {
+	std::lock_guard<std::mutex> guard(*indexes->Lock);
+	return indexes->Order.Count;
+}
+
+//
+// FUNCTION     : InitializeIndexes
+// DESCRIPTION  : Initializes empty secondary indexes
+// PARAMETERS   : CitationIndexes* indexes : Secondary indexes
+// RETURNS      : void
+//
+void InitializeIndexes(CitationIndexes* indexes) {
+	memset(indexes, 0, sizeof(CitationIndexes));
+	indexes->Order.Head = (OrderNode*)calloc(1, sizeof(OrderNode) + (ORDER_MAX_LEVEL - 1) * sizeof(OrderNode*));
+	if (indexes->Order.Head == NULL) {
+		printf("Insufficient memory to create indexes. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	indexes->Order.Head->Level = ORDER_MAX_LEVEL;
+	indexes->Order.Level = 1;
+	indexes->Order.Random = 0x9E3779B97F4A7C15ULL;
+	indexes->NextSequence = 1;
+	indexes->Lock = new std::mutex();
+}
+
+//
+// FUNCTION     : IndexCitation
+// DESCRIPTION  : Adds a citation to every secondary index using its current year, URL, author and title. A citation
+//                indexed for the first time is given the next sequence number
+// PARAMETERS   : CitationIndexes* indexes : Secondary indexes
+//                Citation* citation       : Citation to add
+// RETURNS      : void
+//
+void IndexCitation(CitationIndexes* indexes, Citation* citation) {
+	char token[LINE_SIZE];
+	size_t length = 0;
+	const char* host = URLHost(GetCitationURL(citation), &length);
+
+	int keyLength = 0;
+	CollationKey(citation, &keyLength);
+
+	std::lock_guard<std::mutex> guard(*indexes->Lock);
+
+	if (citation->Sequence == 0) {
+		citation->Sequence = indexes->NextSequence;
+		indexes->NextSequence++;
+	}
+	AddOrder(&indexes->Order, citation);
+	AddYear(&indexes->Years, citation);
+	AddTerm(&indexes->Hosts, host, length, citation);
+
+	const char* p = GetCitationAuthor(citation);
+	while ((length = NextToken(&p, token)) > 0) {
+		AddTerm(&indexes->Authors, token, length, citation);
+	}
+
+	p = GetCitationTitle(citation);
+	while ((length = NextToken(&p, token)) > 0) {
+		AddTerm(&indexes->Titles, token, length, citation);
+	}
+}
+
+//
+// FUNCTION     : UnindexCitation
+// DESCRIPTION  : Removes a citation from every secondary index and discards its collation key. Must be called before
+//                the year, author or title of a citation changes (and IndexCitation after), or before the citation is
+//                freed
+// PARAMETERS   : CitationIndexes* indexes : Secondary indexes
+//                Citation* citation       : Citation to remove
+// RETURNS      : void
+//
+void UnindexCitation(CitationIndexes* indexes, Citation* citation) {
+	char token[LINE_SIZE];
+	size_t length = 0;
+	const char* host = URLHost(GetCitationURL(citation), &length);
+
+	std::lock_guard<std::mutex> guard(*indexes->Lock);
+
+	int position = FindYear(&indexes->Years, GetCitationYear(citation));
+	if (position < indexes->Years.Count && indexes->Years.Entries[position].Year == GetCitationYear(citation)) {
+		RemovePosting(&indexes->Years.Entries[position].List, citation);
+	}
+	RemoveTerm(&indexes->Hosts, host, length, citation);
+
+	const char* p = GetCitationAuthor(citation);
+	while ((length = NextToken(&p, token)) > 0) {
+		RemoveTerm(&indexes->Authors, token, length, citation);
+	}
+
+	p = GetCitationTitle(citation);
+	while ((length = NextToken(&p, token)) > 0) {
+		RemoveTerm(&indexes->Titles, token, length, citation);
+	}
+
+	// The ordered index is searched by collation key, so the key can only be discarded once the citation is removed
+	if (citation->CollationKey != NULL) {
+		RemoveOrder(&indexes->Order, citation);
+	}
+	invalidateCollationKey(citation);
+}
+
+//
+// FUNCTION     : ComparePointers
+// DESCRIPTION  : Compares two citation pointers for qsort and bsearch
+// PARAMETERS   : const void* a : Pointer to first citation pointer
+//                const void* b : Pointer to second citation pointer
+// RETURNS      : int
+//
+static int ComparePointers(const void* a, const void* b) {
+	Citation* first = *(Citation* const*)a;
+	Citation* second = *(Citation* const*)b;
+	return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+//
+// FUNCTION     : SearchWordIndex
+// DESCRIPTION  : Finds the citations containing every word of a search. The words are normalized the same way as
+//                indexed fields, and only the postings lists of the words are read (the rarest list is checked against
+//                sorted copies of the others)
+// PARAMETERS   : CitationIndexes* indexes : Secondary indexes
+//                TermIndex* index         : Term index to search (&indexes->Authors or &indexes->Titles)
+//                const char* words        : Words to search for
+//                Citation*** results      : Set to an allocated array of the matching citations (caller frees it)
+// RETURNS      : int                      : Number of matching citations
+//
+int SearchWordIndex(CitationIndexes* indexes, TermIndex* index, const char* words, Citation*** results) {
+	char token[LINE_SIZE];
+	Postings* lists[SEARCH_MAX_WORDS];
+	int listCount = 0;
+	int found = 0;
+	size_t length = 0;
+	const char* p = words;
+
+	*results = NULL;
+
+	std::lock_guard<std::mutex> guard(*indexes->Lock);
+
+	// Look up the postings list of every word
+	while (listCount < SEARCH_MAX_WORDS && (length = NextToken(&p, token)) > 0) {
+		if (index->Capacity == 0) {
+			return 0;
+		}
+		TermEntry* entry = FindTerm(index, token, length, HashFast(token, length));
+		if (entry->Term == NULL || entry->List.Count == 0) {
+			return 0;
+		}
+		lists[listCount] = &entry->List;
+		listCount++;
+	}
+	if (listCount == 0) {
+		return 0;
+	}
+
+	// Start from the rarest word
+	int rarest = 0;
+	for (int i = 1; i < listCount; i++) {
+		if (lists[i]->Count < lists[rarest]->Count) {
+			rarest = i;
+		}
+	}
+
+	// Sort copies of the other lists so candidates can be checked with a binary search
+	Citation** sorted[SEARCH_MAX_WORDS];
+	for (int i = 0; i < listCount; i++) {
+		sorted[i] = NULL;
+		if (i != rarest) {
+			sorted[i] = (Citation**)malloc(lists[i]->Count * sizeof(Citation*));
+			if (sorted[i] == NULL) {
+				printf("Insufficient memory to search citations. Exiting program...\n");
+				exit(EXIT_FAILURE);
+			}
+			memcpy(sorted[i], lists[i]->Items, lists[i]->Count * sizeof(Citation*));
+			qsort(sorted[i], lists[i]->Count, sizeof(Citation*), ComparePointers);
+		}
+	}
+
+	*results = (Citation**)malloc(lists[rarest]->Count * sizeof(Citation*));
+	if (*results == NULL) {
+		printf("Insufficient memory to search citations. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int c = 0; c < lists[rarest]->Count; c++) {
+		Citation* candidate = lists[rarest]->Items[c];
+		bool matches = true;
+		for (int i = 0; i < listCount && matches; i++) {
+			if (i != rarest && bsearch(&candidate, sorted[i], lists[i]->Count, sizeof(Citation*), ComparePointers) == NULL) {
+				matches = false;
+			}
+		}
+		if (matches) {
+			(*results)[found] = candidate;
+			found++;
+		}
+	}
+
+	for (int i = 0; i < listCount; i++) {
+		free(sorted[i]);
+	}
+
+	return found;
+}
+
+//
+// FUNCTION     : SearchHostIndex
+// DESCRIPTION  : Returns the citations whose URL is on a given host. The list belongs to the index, so it must not be
+//                used while another thread changes the indexes
+// PARAMETERS   : CitationIndexes* indexes : Secondary indexes
+//                const char* host         : Host to search for (e.g. "example.com")
+// RETURNS      : Postings*                : Postings list, or NULL if no citation is on the host
+//
+Postings* SearchHostIndex(CitationIndexes* indexes, const char* host) {
+	char lowered[LINE_SIZE];
+	size_t length = 0;
+	while (host[length] != '\0' && length < LINE_SIZE - 1) {
+		lowered[length] = (char)tolower((unsigned char)host[length]);
+		length++;
+	}
+
+	std::lock_guard<std::mutex> guard(*indexes->Lock);
+
+	if (indexes->Hosts.Capacity == 0) {
+		return NULL;
+	}
+
+	TermEntry* entry = FindTerm(&indexes->Hosts, lowered, length, HashFast(lowered, length));
+	if (entry->Term == NULL || entry->List.Count == 0) {
+		return NULL;
+	}
+	return &entry->List;
+}
+
+//
+// FUNCTION     : SearchYearIndex
+// DESCRIPTION  : Finds the years of a range in the year index. The matching entries are contiguous and in order, and
+//                belong to the index, so they must not be used while another thread changes the indexes
+// PARAMETERS   : CitationIndexes* indexes : Secondary indexes
+//                int from                 : First year of the range
+//                int to                   : Last year of the range
+//                YearEntry** first        : Set to the first matching entry
+// RETURNS      : int                      : Number of matching entries
+//
+int SearchYearIndex(CitationIndexes* indexes, int from, int to, YearEntry** first) {
+	std::lock_guard<std::mutex> guard(*indexes->Lock);
+
+	int start = FindYear(&indexes->Years, from);
+	int end = FindYear(&indexes->Years, to + 1);
+	*first = &indexes->Years.Entries[start];
+	return end > start ? end - start : 0;
+}
+
+//
+// FUNCTION     : FreeTermIndex
+// DESCRIPTION  : Frees every term and postings list of a term index
+// PARAMETERS   : TermIndex* index : Term index
+// RETURNS      : void
+//
+static void FreeTermIndex(TermIndex* index) {
+	for (unsigned int i = 0; i < index->Capacity; i++) {
+		if (index->Entries[i].Term != NULL) {
+			free(index->Entries[i].Term);
+			free(index->Entries[i].List.Items);
+			free(index->Entries[i].List.Slots);
+		}
+	}
+	free(index->Entries);
+}
+
+//
+// FUNCTION     : FreeIndexes
+// DESCRIPTION  : Frees all memory of the secondary indexes (not the citations). Ordered index nodes from the node
+//                pool are freed with the pool (see freeMemory), so only the nodes with more levels are visited
+// PARAMETERS   : CitationIndexes* indexes : Secondary indexes
+// RETURNS      : void
+//
+void FreeIndexes(CitationIndexes* indexes) {
+	for (int i = 0; i < indexes->Years.Count; i++) {
+		free(indexes->Years.Entries[i].List.Items);
+		free(indexes->Years.Entries[i].List.Slots);
+	}
+	free(indexes->Years.Entries);
+	FreeTermIndex(&indexes->Hosts);
+	FreeTermIndex(&indexes->Authors);
+	FreeTermIndex(&indexes->Titles);
+
+	// Only the head and nodes above ORDER_POOL_LEVELS levels have a link at that level, and they were all malloc'd
+	OrderNode* current = indexes->Order.Head;
+	OrderNode* next = NULL;
+	while (current != NULL) {
+		next = current->Next[ORDER_POOL_LEVELS];
+		free(current);
+		current = next;
+	}
+	delete indexes->Lock;
+}
@@ -3,177 +3,286 @@
 * PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
 * PROGRAMMER    : Vanesa Robledo
 * FIRST VERSION : 2025-03-21
-* DESCRIPTION   : This file contains functions needed for inserting into a sorted linked list the LaTeX Citation Manager
+* DESCRIPTION   : This file contains functions needed for sorting the citations of the LaTeX Citation Manager
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
-#include <regex>
+#include <thread>
 
 #include "Citations.h"
 
+// Define constants
+#define SORT_PARALLEL_MIN	65536	// Smallest number of citations sorted on several threads
+
+// Number of threads used to sort (0 uses one per processor)
+static int SortThreads = 0;
+
+//
+// FUNCTION     :	compareCollationKeys
+// DESCRIPTION  :	Checks if one citation comes strictly after another reverse-alphabetically by collation key
+// PARAMETERS   :	Citation* citation1	: First citation
+//					Citation* citation2	: Second citation
+// RETURNS      :	bool				: true if citation1 comes strictly after citation2
 //
-// FUNCTION     :	InsertSorted
-// DESCRIPTION  :	Inserts a citation node in a linked list reverse-alphabetically by author, title, or URL
-// PARAMETERS   :	Citation** Head		: Double pointer to head of sorted linked list
-//					Citation* newCitation	: Citation node to insert into list
+static bool compareCollationKeys(Citation* citation1, Citation* citation2) {
+	// Keys end with a marker, so comparing up to and including the shorter marker orders prefixes correctly
+	int length = citation1->CollationLength < citation2->CollationLength ? citation1->CollationLength : citation2->CollationLength;
+	return memcmp(citation1->CollationKey, citation2->CollationKey, length + 1) > 0;
+}
+
+//
+// FUNCTION     :	MergeRuns
+// DESCRIPTION  :	Merges two adjacent sorted runs of citations into the same positions of another array, taking from
+//					the right run only if it comes strictly after the left run, so equal keys stay in order
+// PARAMETERS   :	Citation** from	: Array holding the runs [start, middle) and [middle, end)
+//					Citation** to	: Array to store the merged run in [start, end)
+//					int start		: Start of the left run
+//					int middle		: Start of the right run
+//					int end			: End of the right run
 // RETURNS      :	void
 //
-void InsertSorted(Citation** Head, Citation* newCitation) {
-	// Error-checking - if newCitation is valid
-	if (newCitation == NULL) {
-		printf("Error: Invalid pointer to citation. Did not insert into sorted linked list.\n");
-		return;
-	}
+static void MergeRuns(Citation** from, Citation** to, int start, int middle, int end) {
+	int left = start;
+	int right = middle;
 
-	// If list is empty - insert directly as head
-	if (*Head == NULL) {
-		*Head = newCitation;
-		return;
+	for (int i = start; i < end; i++) {
+		if (left < middle && (right >= end || !compareCollationKeys(from[right], from[left]))) {
+			to[i] = from[left];
+			left++;
+		}
+		else {
+			to[i] = from[right];
+			right++;
+		}
 	}
+}
 
-	// Store strings to compare
-	char* currentCitation;
-	char* nextCitation;
+//
+// FUNCTION     :	MergeSortCitations
+// DESCRIPTION  :	Stable merge sort of citations reverse-alphabetically by collation key. Citations with equal keys
+//					keep their original order. Every citation must already have its collation key built
+// PARAMETERS   :	Citation** citations	: Citations to sort
+//					Citation** temp			: Scratch space for count citations
+//					int count				: Number of citations
+// RETURNS      :	void
+//
+static void MergeSortCitations(Citation** citations, Citation** temp, int count) {
+	// Bottom-up: merge runs of width 1, 2, 4, ... swapping the source and destination arrays each pass
+	Citation** from = citations;
+	Citation** to = temp;
 
-	// Store whether or not new string occurs alphabetically after current string
-	bool diff = false;
+	for (int width = 1; width < count; width *= 2) {
+		for (int start = 0; start < count; start += 2 * width) {
+			int middle = start + width < count ? start + width : count;
+			int end = start + 2 * width < count ? start + 2 * width : count;
+			MergeRuns(from, to, start, middle, end);
+		}
 
-	// Store string for comparison for current citation
-	if (strlen(newCitation->Author) > 0) {
-		currentCitation = _strdup(newCitation->Author);
+		Citation** swap = from;
+		from = to;
+		to = swap;
 	}
-	else if (strlen(newCitation->Title) > 0) {
-		currentCitation = _strdup(newCitation->Title);
-	}
-	else {
-		currentCitation = trimURL(_strdup(newCitation->URL));
+
+	// Copy back if the last pass ended in the scratch space
+	if (from != citations) {
+		memcpy(citations, from, count * sizeof(Citation*));
 	}
+}
 
-	// Check head
-	if (strlen((*Head)->Author) > 0) {
-		nextCitation = _strdup((*Head)->Author);
+//
+// FUNCTION     :	SortChunk
+// DESCRIPTION  :	Builds the collation keys of a chunk of citations and sorts the chunk (run by each sort thread)
+// PARAMETERS   :	Citation** citations	: Citations of the chunk
+//					Citation** temp			: Scratch space for count citations
+//					int count				: Number of citations in the chunk
+// RETURNS      :	void
+//
+static void SortChunk(Citation** citations, Citation** temp, int count) {
+	int length = 0;
+	for (int i = 0; i < count; i++) {
+		CollationKey(citations[i], &length);
 	}
-	else if (strlen((*Head)->Title) > 0) {
-		nextCitation = _strdup((*Head)->Title);
+	MergeSortCitations(citations, temp, count);
+}
+
+//
+// FUNCTION     :	ParallelSortCitations
+// DESCRIPTION  :	Sorts citations like MergeSortCitations using several threads. The array is split into one
+//					contiguous chunk per thread, each chunk is sorted on its own thread, and then neighbouring chunks
+//					are merged in pairs (each pair on its own thread) until one run is left. Merging always keeps the
+//					left chunk first on ties, so the result is the same as the single-threaded sort
+// PARAMETERS   :	Citation** citations	: Citations to sort
+//					Citation** temp			: Scratch space for count citations
+//					int count				: Number of citations
+//					int threads				: Number of threads to use
+// RETURNS      :	void
+//
+static void ParallelSortCitations(Citation** citations, Citation** temp, int count, int threads) {
+	// Chunk boundaries - chunk i is [bounds[i], bounds[i + 1])
+	int* bounds = (int*)malloc((threads + 1) * sizeof(int));
+	std::thread* workers = new std::thread[threads];
+	if (bounds == NULL) {
+		printf("Insufficient memory to sort citations. Exiting program...\n");
+		exit(EXIT_FAILURE);
 	}
-	else {
-		nextCitation = trimURL(_strdup((*Head)->URL));
+	for (int i = 0; i <= threads; i++) {
+		bounds[i] = (int)((long long)count * i / threads);
 	}
 
-	diff = compareStrings(currentCitation, nextCitation);
-
-	// Insert as new head if it comes alphabetically after head
-	if (diff) {
-		newCitation->Next = *Head;
-		*Head = newCitation;
-		return;
+	// Sort every chunk
+	for (int i = 0; i < threads; i++) {
+		workers[i] = std::thread(SortChunk, citations + bounds[i], temp + bounds[i], bounds[i + 1] - bounds[i]);
+	}
+	for (int i = 0; i < threads; i++) {
+		workers[i].join();
 	}
 
-	// Iterate through list
-	Citation* current = *Head;
-
-	while (current->Next != NULL) {
-		if (strlen(current->Next->Author) > 0) {
-			nextCitation = _strdup(current->Next->Author);
+	// Merge neighbouring runs until one is left, swapping the source and destination arrays each round
+	Citation** from = citations;
+	Citation** to = temp;
+	int runs = threads;
+	while (runs > 1) {
+		int merges = 0;
+		for (int i = 0; i + 1 < runs; i += 2) {
+			workers[merges] = std::thread(MergeRuns, from, to, bounds[i], bounds[i + 1], bounds[i + 2]);
+			merges++;
 		}
-		else if (strlen(current->Next->Title) > 0) {
-			nextCitation = _strdup(current->Next->Title);
+		// An odd run out is copied over as it is
+		if (runs % 2 == 1) {
+			memcpy(to + bounds[runs - 1], from + bounds[runs - 1], (bounds[runs] - bounds[runs - 1]) * sizeof(Citation*));
 		}
-		else {
-			nextCitation = trimURL(_strdup(current->Next->URL));
+		for (int i = 0; i < merges; i++) {
+			workers[i].join();
 		}
 
-		// Compare both strings
-		diff = compareStrings(currentCitation, nextCitation);
-
-		// If newCitation is alphabetically after next citation, break
-		if (diff) {
-			break;
+		// Drop the boundaries between merged pairs
+		int kept = 0;
+		for (int i = 0; i <= runs; i += 2) {
+			bounds[kept] = bounds[i];
+			kept++;
 		}
-		// Otherwise, keep iterating
-		else {
-			diff = false; // Reset flag
-			current = current->Next;
+		if (runs % 2 == 1) {
+			bounds[kept] = bounds[runs];
+			kept++;
 		}
+		runs = kept - 1;
+
+		Citation** swap = from;
+		from = to;
+		to = swap;
+	}
+
+	// Copy back if the last round ended in the scratch space
+	if (from != citations) {
+		memcpy(citations, from, count * sizeof(Citation*));
 	}
 
-	// Insert into sorted linked list
-	newCitation->Next = current->Next;
-	current->Next = newCitation;
+	delete[] workers;
+	free(bounds);
+}
+
+//
+// FUNCTION     :	SetSortThreads
+// DESCRIPTION  :	Sets the number of threads used to sort large queues of citations
+// PARAMETERS   :	int threads	: Number of threads (0 uses one per processor, 1 always sorts on the calling thread)
+// RETURNS      :	void
+//
+void SetSortThreads(int threads) {
+	SortThreads = threads < 0 ? 0 : threads;
 }
 
 //
 // FUNCTION     :	SortQueue
-// DESCRIPTION  :	Dequeues all citations, inserts them into a sorted linked list, and then adds them back to queue
-// PARAMETERS   :	Citation* Head				: Pointer to head of sorted linked list
+// DESCRIPTION  :	Sorts the citations in the queue reverse-alphabetically by author, title, or URL. Citations with the
+//					same author, title or URL stay in the order they were added. The library keeps every citation in
+//					sort order as it is added or changed (see FirstOrdered), so when the queue holds a large part of the
+//					library it is rebuilt by walking that order in time linear in the library. A queue much smaller than
+//					the library is merge sorted instead, in O(q log q), on several threads for queues of at least
+//					SORT_PARALLEL_MIN citations (see SetSortThreads)
+// PARAMETERS   :	CitationManager* Citations	: Hash table containing citations (NULL to always merge sort)
 //					Queue* CitationsToProcess	: Queue to store citations that need to be processed
 // RETURNS      :	void
 //
-void SortQueue(Citation* Head, Queue* CitationsToProcess) {
+void SortQueue(CitationManager* Citations, Queue* CitationsToProcess) {
 	// Check if queue is empty
 	if (isQueueEmpty(CitationsToProcess)) {
 		printf("Error: No sorted citations to process.\n");
 		return;
 	}
 
-	// Move all citations from queue to sorted linked list
-	Citation* current = CitationsToProcess->Front;
-	Citation* sortedNode;
-	Citation* next;
-
-	while (current != NULL) {
-		// Store next pointer in queue
-		next = current->Next;
-
-		// Insert dequeued node into sorted linked list
-		sortedNode = Dequeue(CitationsToProcess);
-		sortedNode->Next = NULL; // Reset Next pointer
-		InsertSorted(&Head, sortedNode);
-
-		// Move pointer to next in queue
-		current = next;
+	// Build a new ring buffer of the same size with its front at the start and no removed slots
+	Citation** citations = (Citation**)malloc(CitationsToProcess->Capacity * sizeof(Citation*));
+	if (citations == NULL) {
+		printf("Insufficient memory to sort citations. Exiting program...\n");
+		exit(EXIT_FAILURE);
 	}
+	int live = CitationsToProcess->Count - CitationsToProcess->Removed;
+	int count = 0;
 
-	// Add all citations back to queue
-	Citation* current2 = Head;
-	Citation* next2;
-
-	while (current2 != NULL) {
-		next2 = current2->Next;
-		Enqueue(CitationsToProcess, current2);
-		current2 = next2;
+	// Take the citations of the queue from the library's sort order, unless the queue is so much smaller than the
+	// library that sorting it costs less than walking every citation of the library (about live * log2(live) steps)
+	int sortSteps = 1;
+	for (int rest = live; rest > 1; rest /= 2) {
+		sortSteps++;
 	}
-	
-	// Reset head pointer to sorted linked list
-	Head = NULL;
-}
-
-//
-// FUNCTION     :	FreeSortedLinkedList
-// DESCRIPTION  :	Frees all memory in linked list
-// PARAMETERS   :	Citation** Head	: Pointer to head of sorted linked list
-// RETURNS      :	void
-//
-void FreeSortedLinkedList(Citation* Head) {
-	// If list is already empty, return
-	if (Head == NULL) {
-		return;
+	if (Citations != NULL && (long long)live * sortSteps >= OrderedCount(&Citations->Indexes)) {
+		for (OrderNode* node = FirstOrdered(&Citations->Indexes); node != NULL && count < live; node = node->Next[0]) {
+			Citation* citation = node->Citation;
+			if (GetCitationState(citation) == CITATION_PENDING && citation->Position >= 0 &&
+				citation->Position < CitationsToProcess->Capacity && CitationsToProcess->Items[citation->Position] == citation) {
+				citations[count] = citation;
+				count++;
+			}
+		}
 	}
 
-	// Iterate through linked list and free memory
-	Citation* toFree = NULL;
-	Citation* current = Head;
+	// Merge sort the queue if some of its citations are not in the library
+	if (count != live) {
+		Citation** temp = (Citation**)malloc(CitationsToProcess->Count * sizeof(Citation*));
+		if (temp == NULL) {
+			printf("Insufficient memory to sort citations. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		count = 0;
+		for (int i = 0; i < CitationsToProcess->Count; i++) {
+			Citation* citation = QueueAt(CitationsToProcess, i);
+			if (citation != NULL) {
+				citations[count] = citation;
+				count++;
+			}
+		}
 
-	while (current->Next != NULL) {
-		toFree = current;
-		current = current->Next;
-		free(toFree);
-	}
+		// Use one thread per processor unless a thread count was set, and keep small sorts on this thread
+		int threads = SortThreads;
+		if (threads == 0) {
+			threads = (int)std::thread::hardware_concurrency();
+		}
+		if (count < SORT_PARALLEL_MIN || threads < 2) {
+			threads = 1;
+		}
+		if (threads > count / (SORT_PARALLEL_MIN / 4)) {
+			threads = count / (SORT_PARALLEL_MIN / 4);
+		}
 
-	free(current);
+		if (threads > 1) {
+			ParallelSortCitations(citations, temp, count, threads);
+		}
+		else {
+			SortChunk(citations, temp, count);
+		}
+		free(temp);
+	}
 
-	printf("Linked list was completely freed.\n");
-}
\ No newline at end of file
+	// Replace the queue's ring buffer with the sorted one
+	for (int i = 0; i < count; i++) {
+		citations[i]->Position = i;
+	}
+	free(CitationsToProcess->Items);
+	CitationsToProcess->Items = citations;
+	CitationsToProcess->Front = 0;
+	CitationsToProcess->Count = count;
+	CitationsToProcess->Removed = 0;
+}
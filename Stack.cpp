@@ -13,6 +13,9 @@
 
 #include "Citations.h"
 
+// Define constants
+#define STACK_SIZE	16	// Initial number of citations the stack can hold
+
 
 //
 // FUNCTION     : InitializeStack
@@ -21,7 +24,7 @@
 // RETURNS      : Stack*
 //
 struct Stack* InitializeStack() {
-	Stack* stack = (Stack*)malloc(sizeof(Stack*));
+	Stack* stack = (Stack*)malloc(sizeof(Stack));
 
 	// Check if memory was allocated; if not, exit program
 	if (stack == NULL) {
@@ -29,26 +32,68 @@ struct Stack* InitializeStack() {
 		exit(EXIT_FAILURE);
 	}
 
-	// Initialize head node value of stack
-	stack->Top = NULL;
-	stack->StackIndex = -1;
+	// Initialize empty array of citations
+	stack->Items = (Citation**)malloc(STACK_SIZE * sizeof(Citation*));
+	if (stack->Items == NULL) {
+		printf("Insufficient memory to create stack. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	stack->Capacity = STACK_SIZE;
+	stack->Count = 0;
+	stack->Removed = 0;
 
 	return stack;
 }
 
 //
 // FUNCTION     : isStackEmpty
-// DESCRIPTION  : Returns boolean if stack is empty by checking the Top pointer
+// DESCRIPTION  : Returns boolean if stack is empty by checking the number of citations
 // PARAMETERS   : Stack* ProcessedCitations : Stack of citations that have been processed
 // RETURNS      : bool
 //
 bool isStackEmpty(Stack* ProcessedCitations) {
-	return ProcessedCitations->Top == NULL;
+	return ProcessedCitations->Count == 0;
+}
+
+//
+// FUNCTION     : TrimStack
+// DESCRIPTION  : Drops tombstones from the top of the stack
+// PARAMETERS   : Stack* ProcessedCitations	: Stack of citations that have been processed
+// RETURNS      : void
+//
+static void TrimStack(Stack* ProcessedCitations) {
+	while (ProcessedCitations->Count > 0 && ProcessedCitations->Items[ProcessedCitations->Count - 1] == NULL) {
+		ProcessedCitations->Count--;
+		ProcessedCitations->Removed--;
+	}
+}
+
+//
+// FUNCTION     : CompactStack
+// DESCRIPTION  : Drops every tombstone from the stack, updating the position of every citation that moves
+// PARAMETERS   : Stack* ProcessedCitations	: Stack of citations that have been processed
+// RETURNS      : void
+//
+static void CompactStack(Stack* ProcessedCitations) {
+	int count = 0;
+	for (int i = 0; i < ProcessedCitations->Count; i++) {
+		Citation* citation = ProcessedCitations->Items[i];
+		if (citation != NULL) {
+			ProcessedCitations->Items[count] = citation;
+			citation->Position = count;
+			count++;
+		}
+	}
+	for (int i = count; i < ProcessedCitations->Count; i++) {
+		ProcessedCitations->Items[i] = NULL;
+	}
+	ProcessedCitations->Count = count;
+	ProcessedCitations->Removed = 0;
 }
 
 //
 // FUNCTION     : Push
-// DESCRIPTION  : Adds a Citation node to the Top of the stack
+// DESCRIPTION  : Adds a Citation node to the Top of the stack and marks it as processed
 // PARAMETERS   : Stack* ProcessedCitations		: Stack of citations that have been processed
 //				  Citation* completedCitation	: Citation that has been processed
 // RETURNS      : none
@@ -64,9 +109,25 @@ void Push(Stack* ProcessedCitations, Citation* completedCitation) {
 		return;
 	}
 
-	completedCitation->Next = ProcessedCitations->Top;
-	ProcessedCitations->Top = completedCitation;
-	ProcessedCitations->StackIndex++;
+	// If array is full, clear out tombstones, growing it if it is still more than half full
+	if (ProcessedCitations->Count == ProcessedCitations->Capacity) {
+		CompactStack(ProcessedCitations);
+		if (ProcessedCitations->Count * 2 > ProcessedCitations->Capacity) {
+			int capacity = ProcessedCitations->Capacity * 2;
+			Citation** items = (Citation**)realloc(ProcessedCitations->Items, capacity * sizeof(Citation*));
+			if (items == NULL) {
+				printf("Insufficient memory to add to stack. Exiting program...\n");
+				exit(EXIT_FAILURE);
+			}
+			ProcessedCitations->Items = items;
+			ProcessedCitations->Capacity = capacity;
+		}
+	}
+
+	ProcessedCitations->Items[ProcessedCitations->Count] = completedCitation;
+	completedCitation->Position = ProcessedCitations->Count;
+	SetCitationState(completedCitation, CITATION_PROCESSED);
+	ProcessedCitations->Count++;
 }
 
 //
@@ -83,34 +144,72 @@ Citation* Pop(Stack* ProcessedCitations) {
 		return toPop;
 	}
 
-	toPop = ProcessedCitations->Top;
-	ProcessedCitations->Top = ProcessedCitations->Top->Next;
-	ProcessedCitations->StackIndex--;
-
-	toPop->Next = NULL;
+	ProcessedCitations->Count--;
+	toPop = ProcessedCitations->Items[ProcessedCitations->Count];
+	ProcessedCitations->Items[ProcessedCitations->Count] = NULL;
+	TrimStack(ProcessedCitations);
 
+	toPop->Position = -1;
 	return toPop;
 }
 
+//
+// FUNCTION     : RemoveFromStack
+// DESCRIPTION  : Removes a citation from anywhere in the stack in constant time using its position, leaving a
+//				  tombstone. The stack is compacted once more than half of its slots are tombstones
+// PARAMETERS   : Stack* ProcessedCitations	: Stack of citations that have been processed
+//				  Citation* citation		: Citation to remove
+// RETURNS      : bool						: true if the citation was in the stack
+//
+bool RemoveFromStack(Stack* ProcessedCitations, Citation* citation) {
+	if (citation->Position < 0 || citation->Position >= ProcessedCitations->Count ||
+		ProcessedCitations->Items[citation->Position] != citation) {
+		return false;
+	}
+
+	ProcessedCitations->Items[citation->Position] = NULL;
+	ProcessedCitations->Removed++;
+	citation->Position = -1;
+	TrimStack(ProcessedCitations);
+
+	if (ProcessedCitations->Removed * 2 > ProcessedCitations->Count) {
+		CompactStack(ProcessedCitations);
+	}
+	return true;
+}
+
+//
+// FUNCTION     : printStack
+// DESCRIPTION  : Prints all citations in the stack from top to bottom
+// PARAMETERS   : Stack* ProcessedCitations	: Stack of citations that have been processed
+// RETURNS      : void
+//
+void printStack(Stack* ProcessedCitations) {
+	for (int i = ProcessedCitations->Count - 1; i >= 0; i--) {
+		if (ProcessedCitations->Items[i] != NULL) {
+			printCitation(ProcessedCitations->Items[i]);
+			printf("---------------------------------------------\n");
+		}
+	}
+}
+
 //
 // FUNCTION     : FreeStack
-// DESCRIPTION  : Frees memory of citations in the stack
+// DESCRIPTION  : Frees memory of the stack. The citations in it are not visited - they are freed all at once with the
+//				  citation store and node pools (see freeMemory)
 // PARAMETERS   : Stack* ProcessedCitations	: Stack of citations that have been processed
 // RETURNS      : void
 //
 void FreeStack(Stack* ProcessedCitations) {
-	// Check if stack is empty
-	if (isStackEmpty(ProcessedCitations)) {
-		return;
-	}
-	// If stack is not empty, free memory
-	Citation* toFree = NULL;
-	while (ProcessedCitations->Top != NULL) {
-		toFree = ProcessedCitations->Top;
-		ProcessedCitations->Top = ProcessedCitations->Top->Next;
-		ProcessedCitations->StackIndex--;
-		free(toFree);
+	// Free the array
+	bool hadCitations = !isStackEmpty(ProcessedCitations);
+	free(ProcessedCitations->Items);
+	ProcessedCitations->Items = NULL;
+	ProcessedCitations->Capacity = 0;
+	ProcessedCitations->Count = 0;
+	ProcessedCitations->Removed = 0;
+
+	if (hadCitations) {
+		printf("Stack was completely freed.\n");
 	}
-
-	printf("Stack was completely freed.\n");
-}
\ No newline at end of file
+}
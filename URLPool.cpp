@@ -0,0 +1,339 @@
+/*
+* FILE          : URLPool.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the URL canonicalization functions and the pool that interns every URL once, so
+*                 the citation and its key in the hash table share the same string
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <mutex>
+
+#include "Citations.h"
+
+// Define constants
+#define URL_CHUNK_SIZE	65536	// Bytes of URL storage allocated at a time
+#define URL_SET_SIZE	1024	// Initial number of slots in the set of interned URLs (must be a power of 2)
+
+// Define block of URL storage
+typedef struct URLChunk {
+	struct URLChunk* Next;
+	size_t Used;
+	size_t Size;
+	char* Data;
+} URLChunk;
+
+// Define URL Pool
+// Strings are bump-allocated from chunks and never move, so pointers to them stay valid until FreeURLPool.
+// The set of interned URLs uses linear probing on the full hash of each canonical URL
+typedef struct URLPool {
+	URLChunk* Chunks;
+	const char** Strings;
+	unsigned long long* Hashes;
+	unsigned int Capacity;
+	unsigned int Count;
+	int Allocations; // Number of mallocs of chunks and sets
+} URLPool;
+
+// Query parameters that only track where a visitor came from
+static const char* kTrackingParameters[] = {
+	"fbclid", "gclid", "dclid", "gbraid", "wbraid", "msclkid", "mc_cid", "mc_eid", "igshid", "yclid",
+	"_hsenc", "_hsmi", "mkt_tok"
+};
+
+// Pool shared by every citation (PoolLock is held while the set or chunks are changed)
+static URLPool Pool = { NULL, NULL, NULL, 0, 0, 0 };
+static std::mutex PoolLock;
+
+//
+// FUNCTION     : isTrackingParameter
+// DESCRIPTION  : Checks if a query parameter is a known tracking parameter (utm_* or one of kTrackingParameters)
+// PARAMETERS   : const char* param : Start of the parameter
+//                size_t length     : Length of the parameter name (up to '=' or the end of the parameter)
+// RETURNS      : bool
+//
+static bool isTrackingParameter(const char* param, size_t length) {
+	if (length >= 4 && strncmp(param, "utm_", 4) == 0) {
+		return true;
+	}
+
+	int count = sizeof(kTrackingParameters) / sizeof(kTrackingParameters[0]);
+	for (int i = 0; i < count; i++) {
+		if (strlen(kTrackingParameters[i]) == length && strncmp(param, kTrackingParameters[i], length) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//
+// FUNCTION     : canonicalizeURL
+// DESCRIPTION  : Writes the canonical form of a URL: the scheme and host are lowercased, default ports (:80 for http,
+//                :443 for https) and trailing slashes are dropped, and tracking parameters are removed from the query.
+//                The canonical URL is never longer than the original
+// PARAMETERS   : const char* url   : URL to canonicalize (does not need to be null-terminated)
+//                size_t length     : Length of the URL
+//                char* out         : Buffer of at least length + 1 bytes to store the canonical URL
+// RETURNS      : size_t            : Length of the canonical URL
+//
+size_t canonicalizeURL(const char* url, size_t length, char* out) {
+	size_t i = 0;
+	size_t o = 0;
+
+	// Scheme - if there is none, copy the URL as it is
+	while (i < length && (isalnum((unsigned char)url[i]) || url[i] == '+' || url[i] == '-' || url[i] == '.')) {
+		i++;
+	}
+	if (i == 0 || i + 3 > length || strncmp(url + i, "://", 3) != 0) {
+		memcpy(out, url, length);
+		out[length] = '\0';
+		return length;
+	}
+	for (size_t s = 0; s < i; s++) {
+		out[o++] = (char)tolower((unsigned char)url[s]);
+	}
+	size_t schemeLength = o;
+	memcpy(out + o, "://", 3);
+	o += 3;
+	i += 3;
+
+	// Authority - lowercase the host (user info is kept as it is)
+	size_t authorityStart = i;
+	while (i < length && url[i] != '/' && url[i] != '?' && url[i] != '#') {
+		i++;
+	}
+	size_t hostStart = authorityStart;
+	for (size_t a = authorityStart; a < i; a++) {
+		if (url[a] == '@') {
+			hostStart = a + 1;
+		}
+	}
+	size_t authorityOut = o;
+	for (size_t a = authorityStart; a < i; a++) {
+		out[o++] = a >= hostStart ? (char)tolower((unsigned char)url[a]) : url[a];
+	}
+
+	// Drop default or empty port
+	if (schemeLength == 4 && o >= 3 && strncmp(out, "http", 4) == 0 && strncmp(out + o - 3, ":80", 3) == 0) {
+		o -= 3;
+	}
+	else if (schemeLength == 5 && o >= 4 && strncmp(out, "https", 5) == 0 && strncmp(out + o - 4, ":443", 4) == 0) {
+		o -= 4;
+	}
+	else if (o > authorityOut && out[o - 1] == ':') {
+		o--;
+	}
+
+	// Path - copy and drop trailing slashes
+	size_t pathOut = o;
+	while (i < length && url[i] != '?' && url[i] != '#') {
+		out[o++] = url[i++];
+	}
+	while (o > pathOut && out[o - 1] == '/') {
+		o--;
+	}
+
+	// Query - keep every parameter that is not a tracking parameter
+	if (i < length && url[i] == '?') {
+		i++;
+		bool firstParameter = true;
+		while (i < length && url[i] != '#') {
+			size_t paramStart = i;
+			while (i < length && url[i] != '&' && url[i] != '#') {
+				i++;
+			}
+			size_t nameLength = 0;
+			while (paramStart + nameLength < i && url[paramStart + nameLength] != '=') {
+				nameLength++;
+			}
+			if (i > paramStart && !isTrackingParameter(url + paramStart, nameLength)) {
+				out[o++] = firstParameter ? '?' : '&';
+				memcpy(out + o, url + paramStart, i - paramStart);
+				o += i - paramStart;
+				firstParameter = false;
+			}
+			if (i < length && url[i] == '&') {
+				i++;
+			}
+		}
+	}
+
+	// Fragment
+	while (i < length) {
+		out[o++] = url[i++];
+	}
+
+	out[o] = '\0';
+	return o;
+}
+
+//
+// FUNCTION     : URLKey
+// DESCRIPTION  : Returns the part of a canonical URL used as its key in the hash table (everything after the scheme),
+//                so the http and https versions of a page are the same citation
+// PARAMETERS   : const char* url : Canonical URL
+// RETURNS      : const char*
+//
+const char* URLKey(const char* url) {
+	const char* separator = strstr(url, "://");
+	if (separator == NULL) {
+		return url;
+	}
+	return separator + 3;
+}
+
+//
+// FUNCTION     : AllocateURL
+// DESCRIPTION  : Reserves storage for a string of the given length (plus null terminator) in the pool
+// PARAMETERS   : size_t size : Number of bytes needed
+// RETURNS      : char*
+//
+static char* AllocateURL(size_t size) {
+	if (Pool.Chunks == NULL || Pool.Chunks->Used + size > Pool.Chunks->Size) {
+		size_t chunkSize = size > URL_CHUNK_SIZE ? size : URL_CHUNK_SIZE;
+		URLChunk* chunk = (URLChunk*)malloc(sizeof(URLChunk) + chunkSize);
+		if (chunk == NULL) {
+			printf("Insufficient memory to store URL. Exiting program...\n");
+			exit(EXIT_FAILURE);
+		}
+		chunk->Data = (char*)(chunk + 1);
+		chunk->Used = 0;
+		chunk->Size = chunkSize;
+		chunk->Next = Pool.Chunks;
+		Pool.Chunks = chunk;
+		Pool.Allocations++;
+	}
+
+	char* str = Pool.Chunks->Data + Pool.Chunks->Used;
+	Pool.Chunks->Used += size;
+	return str;
+}
+
+//
+// FUNCTION     : GrowURLSet
+// DESCRIPTION  : Doubles the set of interned URLs and reinserts every URL
+// PARAMETERS   : none
+// RETURNS      : void
+//
+static void GrowURLSet(void) {
+	unsigned int oldCapacity = Pool.Capacity;
+	const char** oldStrings = Pool.Strings;
+	unsigned long long* oldHashes = Pool.Hashes;
+
+	Pool.Capacity = oldCapacity == 0 ? URL_SET_SIZE : oldCapacity * 2;
+	Pool.Strings = (const char**)calloc(Pool.Capacity, sizeof(const char*));
+	Pool.Hashes = (unsigned long long*)malloc(Pool.Capacity * sizeof(unsigned long long));
+	Pool.Allocations += 2;
+	if (Pool.Strings == NULL || Pool.Hashes == NULL) {
+		printf("Insufficient memory to store URL. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (unsigned int i = 0; i < oldCapacity; i++) {
+		if (oldStrings[i] != NULL) {
+			unsigned int slot = (unsigned int)oldHashes[i] & (Pool.Capacity - 1);
+			while (Pool.Strings[slot] != NULL) {
+				slot = (slot + 1) & (Pool.Capacity - 1);
+			}
+			Pool.Strings[slot] = oldStrings[i];
+			Pool.Hashes[slot] = oldHashes[i];
+		}
+	}
+
+	free(oldStrings);
+	free(oldHashes);
+}
+
+//
+// FUNCTION     : internURL
+// DESCRIPTION  : Canonicalizes a URL and returns the single pooled copy of it. Interning the same canonical URL twice
+//                returns the same pointer. Safe to call from several threads at once
+// PARAMETERS   : const char* url : URL to intern
+// RETURNS      : const char*
+//
+const char* internURL(const char* url) {
+	size_t length = strlen(url);
+	char stackBuffer[LINE_SIZE];
+	char* canonical = length < LINE_SIZE ? stackBuffer : (char*)malloc(length + 1);
+	if (canonical == NULL) {
+		printf("Insufficient memory to store URL. Exiting program...\n");
+		exit(EXIT_FAILURE);
+	}
+	length = canonicalizeURL(url, length, canonical);
+	unsigned long long hash = HashFast(canonical, length);
+
+	std::lock_guard<std::mutex> guard(PoolLock);
+
+	// Keep the set at most half full
+	if ((Pool.Count + 1) * 2 > Pool.Capacity) {
+		GrowURLSet();
+	}
+
+	// Return the pooled copy if it is already interned
+	unsigned int slot = (unsigned int)hash & (Pool.Capacity - 1);
+	while (Pool.Strings[slot] != NULL) {
+		if (Pool.Hashes[slot] == hash && strcmp(Pool.Strings[slot], canonical) == 0) {
+			if (canonical != stackBuffer) {
+				free(canonical);
+			}
+			return Pool.Strings[slot];
+		}
+		slot = (slot + 1) & (Pool.Capacity - 1);
+	}
+
+	// Copy into the pool
+	char* pooled = AllocateURL(length + 1);
+	memcpy(pooled, canonical, length + 1);
+	Pool.Strings[slot] = pooled;
+	Pool.Hashes[slot] = hash;
+	Pool.Count++;
+
+	if (canonical != stackBuffer) {
+		free(canonical);
+	}
+	return pooled;
+}
+
+//
+// FUNCTION     : CountURLPoolAllocations
+// DESCRIPTION  : Returns the number of times the URL pool has allocated memory (adding a chunk or growing its set)
+// PARAMETERS   : none
+// RETURNS      : int
+//
+int CountURLPoolAllocations(void) {
+	std::lock_guard<std::mutex> guard(PoolLock);
+	return Pool.Allocations;
+}
+
+//
+// FUNCTION     : FreeURLPool
+// DESCRIPTION  : Frees every interned URL - no citation may use its URL afterwards
+// PARAMETERS   : none
+// RETURNS      : void
+//
+void FreeURLPool(void) {
+	URLChunk* current = Pool.Chunks;
+	URLChunk* next = NULL;
+	while (current != NULL) {
+		next = current->Next;
+		free(current);
+		current = next;
+	}
+
+	free(Pool.Strings);
+	free(Pool.Hashes);
+	Pool.Chunks = NULL;
+	Pool.Strings = NULL;
+	Pool.Hashes = NULL;
+	Pool.Capacity = 0;
+	Pool.Count = 0;
+	Pool.Allocations = 0;
+
+	printf("URL pool was completely freed.\n");
+}
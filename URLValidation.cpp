@@ -0,0 +1,212 @@
+/*
+* FILE          : URLValidation.cpp
+* PROJECT       : SENG1050 Final Project: LaTeX Citation Manager
+* PROGRAMMER    : Vanesa Robledo
+* FIRST VERSION : 2025-03-21
+* DESCRIPTION   : This file contains the URL validator shared by every place a URL is read (typed in or imported from a
+*                 file). Characters are classified with a table built at compile time, the scheme and authority are
+*                 checked with a small state machine, and the rest of the URL is checked 16 bytes at a time
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define URL_SIMD
+#endif
+
+#include "Citations.h"
+
+// Define URL character classes
+enum URLCharClass {
+	URL_HOST = 1, // Allowed in a host name or user info: letters, digits, "-._~", "!$&'()*+,;=" and '%'
+	URL_PATH = 2, // Allowed in the path, query and fragment: every printable ASCII character except "\"<>\\^`{|}"
+	URL_DIGIT = 4 // Allowed in a port
+};
+
+// Define URL character table
+typedef struct URLCharTable {
+	unsigned char Class[256];
+} URLCharTable;
+
+//
+// FUNCTION     : BuildURLCharTable
+// DESCRIPTION  : Builds the class of every byte (run by the compiler)
+// PARAMETERS   : none
+// RETURNS      : URLCharTable
+//
+static constexpr URLCharTable BuildURLCharTable() {
+	URLCharTable table = {};
+	const char* host = "-._~!$&'()*+,;=%";
+	const char* excluded = "\"<>\\^`{|}";
+
+	for (int c = 0; c < 256; c++) {
+		bool isHost = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+		for (int i = 0; host[i] != '\0'; i++) {
+			isHost = isHost || c == host[i];
+		}
+		bool isPath = c > ' ' && c < 0x7F;
+		for (int i = 0; excluded[i] != '\0'; i++) {
+			isPath = isPath && c != excluded[i];
+		}
+
+		table.Class[c] = (unsigned char)((isHost ? URL_HOST : 0) | (isPath ? URL_PATH : 0) | (c >= '0' && c <= '9' ? URL_DIGIT : 0));
+	}
+	return table;
+}
+
+static constexpr URLCharTable kURLChars = BuildURLCharTable();
+
+//
+// FUNCTION     : hasClass
+// DESCRIPTION  : Checks if a character belongs to a class of URL characters
+// PARAMETERS   : char c             : Character to check
+//                unsigned char type : URLCharClass to check for
+// RETURNS      : bool
+//
+static inline bool hasClass(char c, unsigned char type) {
+	return (kURLChars.Class[(unsigned char)c] & type) != 0;
+}
+
+//
+// FUNCTION     : isPathText
+// DESCRIPTION  : Checks that every character of the path, query and fragment of a URL is allowed. Blocks of 16 bytes
+//                are checked at once where SSE2 is available (the same set as URL_PATH: bytes from '!' to '~' except
+//                "\"<>\\^`{|}"), and the rest with the character table
+// PARAMETERS   : const char* text : Text to check
+//                size_t length    : Length of text
+// RETURNS      : bool
+//
+static bool isPathText(const char* text, size_t length) {
+	size_t i = 0;
+
+#if defined(URL_SIMD)
+	const __m128i low = _mm_set1_epi8(' ');
+	const __m128i high = _mm_set1_epi8(0x7F);
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*)(text + i));
+		// Bytes of 0x80 and above are negative, so the signed compare rejects them with the control characters
+		__m128i allowed = _mm_and_si128(_mm_cmpgt_epi8(block, low), _mm_cmplt_epi8(block, high));
+		__m128i excluded = _mm_or_si128(
+			_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')), _mm_cmpeq_epi8(block, _mm_set1_epi8('<'))),
+				_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('>')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\\')))),
+			_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('^')), _mm_cmpeq_epi8(block, _mm_set1_epi8('`'))),
+				_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('{')),
+					_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('|')), _mm_cmpeq_epi8(block, _mm_set1_epi8('}'))))));
+		if (_mm_movemask_epi8(_mm_andnot_si128(excluded, allowed)) != 0xFFFF) {
+			return false;
+		}
+	}
+#endif
+
+	for (; i < length; i++) {
+		if (!hasClass(text[i], URL_PATH)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//
+// FUNCTION     : isValidURL
+// DESCRIPTION  : Checks if a string is a web URL: "http://" or "https://" (in any case), an authority of optional user
+//                info ending in '@', a host name or bracketed IPv6 address, and an optional port, followed by an
+//                optional path, query and fragment
+// PARAMETERS   : const char* url : URL to check (does not need to be null-terminated)
+//                size_t length   : Length of the URL
+// RETURNS      : bool
+//
+bool isValidURL(const char* url, size_t length) {
+	// Scheme
+	size_t i = 0;
+	if (length < 7) {
+		return false;
+	}
+	for (; i < 4; i++) {
+		if (tolower((unsigned char)url[i]) != "http"[i]) {
+			return false;
+		}
+	}
+	if (tolower((unsigned char)url[i]) == 's') {
+		i++;
+	}
+	if (i + 3 > length || strncmp(url + i, "://", 3) != 0) {
+		return false;
+	}
+	i += 3;
+
+	// Authority runs to the start of the path, query or fragment
+	size_t authorityEnd = i;
+	size_t hostStart = i;
+	while (authorityEnd < length && url[authorityEnd] != '/' && url[authorityEnd] != '?' && url[authorityEnd] != '#') {
+		if (url[authorityEnd] == '@') {
+			hostStart = authorityEnd + 1;
+		}
+		authorityEnd++;
+	}
+
+	// User info (anything before the last '@') may also hold ':'
+	for (; i + 1 < hostStart; i++) {
+		if (!hasClass(url[i], URL_HOST) && url[i] != ':') {
+			return false;
+		}
+	}
+	i = hostStart;
+
+	// Host, then an optional port
+	enum { HOST_START, HOST_NAME, HOST_IPV6, HOST_IPV6_END, HOST_PORT } state = HOST_START;
+	int portDigits = 0;
+	for (; i < authorityEnd; i++) {
+		char c = url[i];
+		switch (state) {
+		case HOST_START:
+			if (c == '[') {
+				state = HOST_IPV6;
+			}
+			else if (hasClass(c, URL_HOST)) {
+				state = HOST_NAME;
+			}
+			else {
+				return false;
+			}
+			break;
+		case HOST_NAME:
+			if (c == ':') {
+				state = HOST_PORT;
+			}
+			else if (!hasClass(c, URL_HOST)) {
+				return false;
+			}
+			break;
+		case HOST_IPV6:
+			if (c == ']') {
+				state = HOST_IPV6_END;
+			}
+			else if (!isxdigit((unsigned char)c) && c != ':' && c != '.') {
+				return false;
+			}
+			break;
+		case HOST_IPV6_END:
+			if (c != ':') {
+				return false;
+			}
+			state = HOST_PORT;
+			break;
+		case HOST_PORT:
+			if (!hasClass(c, URL_DIGIT) || ++portDigits > 5) {
+				return false;
+			}
+			break;
+		}
+	}
+	if (state == HOST_START || state == HOST_IPV6 || (state == HOST_PORT && portDigits == 0)) {
+		return false;
+	}
+
+	// Path, query and fragment
+	return isPathText(url + authorityEnd, length - authorityEnd);
+}
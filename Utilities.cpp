@@ -11,6 +11,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 
 #include "Citations.h"
 
@@ -45,7 +46,8 @@ void menu(void) {
 	printf("[3] Remove citation \n");
 	printf("[4] Process citations\n");
 	printf("[5] Export processed citations\n");
-	printf("[6] Exit\n");
+	printf("[6] Search citations\n");
+	printf("[7] Exit\n");
 }
 
 //
@@ -63,6 +65,21 @@ void processMenu(void) {
 	printf("[5] Cancel processing citations\n");
 }
 
+//
+// FUNCTION     : searchMenu
+// DESCRIPTION  : Prints menu of search citation operations to the screen
+// PARAMETERS   : none
+// RETURNS      : void
+//
+void searchMenu(void) {
+	printf("[1] Search by author\n");
+	printf("[2] Search by title\n");
+	printf("[3] Search by website host\n");
+	printf("[4] Search by range of years\n");
+	printf("--------------------------------------------\n");
+	printf("[5] Cancel searching citations\n");
+}
+
 //
 // FUNCTION		:	getMenuNum
 // DESCRIPTION	:	Asks the user to input a number for menu operation
@@ -112,11 +129,10 @@ void pressEntertoContinue(void) {
 // PARAMETERS   :	CitationManager* Citations	: Hash table containing citations
 //					Queue* CitationsToProcess	: Queue to store citations that need to be processed
 //					Stack* ProcessedCitations	: Stack of citations that have been processed
-//					Citation* Head				: Pointer to head of sorted linked list
 // RETURNS		:	
 //
-void exitProgram(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations, Citation* Head) {
-	freeMemory(Citations, CitationsToProcess, ProcessedCitations, Head);
+void exitProgram(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations) {
+	freeMemory(Citations, CitationsToProcess, ProcessedCitations);
 	printf("Exiting program...\n");
 	exit(EXIT_SUCCESS);
 }
@@ -146,7 +162,7 @@ char* inputURL(void) {
 			url = _strdup("");
 			return url;
 		}
-		else if (std::regex_match(buffer, std::regex("^https?:\\/\\/[A-za-z\\.0-9\\/_\\-\\:\\#\\[\\]\\@\\!\\$\\&\\'\\(\\)\\*\\+\\,\\;\\%\\=]+")) == false) {
+		else if (isValidURL(buffer, strlen(buffer)) == false) {
 			printf("Invalid URL entered.\n");
 		}
 		else {
@@ -337,24 +353,46 @@ void clearNewLineChar(char* str) {
 }
 
 //
-// FUNCTION		: trimURL
-// DESCRIPTION	: Trims the protocol (http://|https://)(www?) from URLs
-// PARAMETERS	: char* str		:	String to be modified
-// RETURNS		: char*			:	Trimmed string
+// FUNCTION		: isTrimURLChar
+// DESCRIPTION	: Checks if a character is one trimURL accepts after the protocol
+// PARAMETERS	: char c		:	Character to check
+// RETURNS		: bool
 //
-char* trimURL(char* str) {
-	// Use <regex> to capture second group
-	std::regex rgx("(?:https:\\/\\/|http:\\/\\/)(?:www.)?([A-za-z0-9\\.\\/_\\-\\:\\#\\[\\]\\@\\!\\$\\&\\'\\(\\)\\*\\+\\,\\;\\%\\=]+)");
-	std::cmatch match;
-	char* trimmedURL;
+static bool isTrimURLChar(char c) {
+	return (c >= 'A' && c <= 'z') || (c >= '0' && c <= '9') || (c != '\0' && strchr("./-:#@!$&'()*+,;%=", c) != NULL);
+}
 
-	if (std::regex_search(str, match, rgx)) {
-		trimmedURL = _strdup(match[1].first);
-		return trimmedURL;
-	}
-	else {
-		return str;
+//
+// FUNCTION		: trimURL
+// DESCRIPTION	: Trims the protocol (http://|https://)(www?) from URLs, without allocating. The first "http://" or
+//				  "https://" followed by a valid URL character is found, and an optional "www" and any one character
+//				  after it are skipped if a valid URL character follows them
+// PARAMETERS	: const char* str	:	String to trim
+// RETURNS		: const char*		:	Pointer to the trimmed part of str (str itself if there is no protocol)
+//
+const char* trimURL(const char* str) {
+	for (const char* p = str; *p != '\0'; p++) {
+		const char* rest = NULL;
+		if (strncmp(p, "https://", 8) == 0) {
+			rest = p + 8;
+		}
+		else if (strncmp(p, "http://", 7) == 0) {
+			rest = p + 7;
+		}
+		else {
+			continue;
+		}
+
+		// Skip "www" and the character after it (any character but a line break)
+		if (strncmp(rest, "www", 3) == 0 && rest[3] != '\0' && rest[3] != '\n' && rest[3] != '\r' && isTrimURLChar(rest[4])) {
+			return rest + 4;
+		}
+		if (isTrimURLChar(rest[0])) {
+			return rest;
+		}
 	}
+
+	return str;
 }
 
 //
@@ -389,20 +427,68 @@ char* trimWhitespace(char* str) {
 	return str;
 }
 
+//
+// FUNCTION     : currentDate
+// DESCRIPTION  : Reads the clock once and returns today's local date
+// PARAMETERS   : void
+// RETURNS      : PackedDate
+//
+PackedDate currentDate(void) {
+	time_t now = time(NULL);
+	struct tm local;
+	if (localtime_s(&local, &now) != 0) {
+		return 0;
+	}
+	return ((PackedDate)(local.tm_year + 1900) << 9) | ((PackedDate)(local.tm_mon + 1) << 5) | (PackedDate)local.tm_mday;
+}
+
+//
+// FUNCTION     : formatDate
+// DESCRIPTION  : Writes a date as YYYY-MM-DD (for printing and exporting)
+// PARAMETERS   : PackedDate date : Date to write
+//				  char* buffer	  : Buffer of at least TIMESTAMP characters
+// RETURNS      : void
+//
+void formatDate(PackedDate date, char* buffer) {
+	sprintf_s(buffer, TIMESTAMP, "%04u-%02u-%02u", date >> 9, (date >> 5) & 0xF, date & 0x1F);
+}
+
+//
+// FUNCTION     : parseDate
+// DESCRIPTION  : Reads a date written as YYYY-MM-DD (the form written by formatDate)
+// PARAMETERS   : const char* text : Date to read
+// RETURNS      : PackedDate	   : The date, or 0 if text is not a valid date
+//
+PackedDate parseDate(const char* text) {
+	unsigned int year = 0;
+	unsigned int month = 0;
+	unsigned int day = 0;
+	char end = '\0';
+
+	if (sscanf_s(text, "%4u-%2u-%2u%c", &year, &month, &day, &end, 1) != 3 || month < 1 || month > 12 || day < 1 || day > 31) {
+		return 0;
+	}
+	return (year << 9) | (month << 5) | day;
+}
+
 //
 // FUNCTION     : freeMemory
-// DESCRIPTION  : Frees all dynamically allocated memory in the program
+// DESCRIPTION  : Frees all dynamically allocated memory in the program. The queue, stack and hash table are dropped
+//				  without visiting their citations, and then every citation, KVP, index node, string and collation key
+//				  is freed a chunk at a time with the citation store, node pools and URL pool
 // PARAMETERS   : CitationManager* Citations	: Hash table containing citations
 //				  Queue* CitationsToProcess		: Queue to store citations that need to be processed
 //				  Stack* ProcessedCitations		: Stack of citations that have been processed
-//				  Citation* Head				: Pointer to head of sorted linked list
 // RETURNS      : void
 //
-void freeMemory(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations, Citation* Head) {
+void freeMemory(CitationManager* Citations, Queue* CitationsToProcess, Stack* ProcessedCitations) {
 	printf("Freeing dynamically allocated memory...\n");
 	FreeQueue(CitationsToProcess);
 	FreeStack(ProcessedCitations);
-	FreeSortedLinkedList(Head);
 	FreeHashTable(Citations);
+	printf("Hash table was completely freed.\n");
+	FreeCitationStore();
+	FreeNodePools();
+	FreeURLPool();
 	printf("Memory cleanup complete.\n");
 }
\ No newline at end of file
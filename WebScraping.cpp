@@ -36,7 +36,8 @@ void WebScraping(Citation* citation) {
     CURL* curl_handle = curl_easy_init();
 
     // Retrieve the HTML document of the target page
-    struct CURLResponse response = GetRequest(curl_handle, citation->URL);
+    struct CURLResponse response = GetRequest(curl_handle, GetCitationURL(citation));
+    SetCitationDateAccessed(citation, currentDate()); // Accessed when it was fetched
 
     // Parse the HTML document returned by the server
     htmlDocPtr doc = htmlReadMemory(response.html, (unsigned long)response.size, NULL, NULL, HTML_PARSE_NOERROR);
@@ -68,6 +69,7 @@ void WebScraping(Citation* citation) {
 
                 // Parse the JSON to assign values
                 parseJSON(json, citation);
+                xmlFree(json);
 
                 // Set flag to true
                 dataRead = true;
@@ -91,9 +93,12 @@ void WebScraping(Citation* citation) {
 
                 // Store data if there is no Cloudflare or anti-bot detection
                 if (strcmp(title, "Just a moment...") != 0) {
-                    citation->Title = (char*)xmlNodeGetContent(node);
+                    SetCitationTitle(citation, title);
                 }
+                xmlFree(title);
             }
+            xmlXPathFreeObject(xpathObjPtr);
+            xmlXPathFreeContext(xpathCtxtPtr);
         }
     }
 
@@ -102,7 +107,9 @@ void WebScraping(Citation* citation) {
     // XML Data Cleanup
     xmlXPathFreeObject(xpathObjPtr);
     xmlXPathFreeContext(xpathCtxtPtr);
+    xmlXPathFreeContext(context);
     xmlFreeDoc(doc);
+    free(response.html);
     xmlCleanupParser();
 
     // Cleanup the curl instance
@@ -128,7 +135,7 @@ static size_t WriteHTMLCallback(void* contents, size_t size, size_t nmemb, void*
 
     if (!ptr)
     {
-        printf("Not enough memory available (realloc returned NULL)\n");
+        fprintf(stderr, "Not enough memory available (realloc returned NULL)\n");
         return 0;
     }
 